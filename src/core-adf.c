@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2026 Kernel Labs Inc. All Rights Reserved
+ *
+ * Address: Kernel Labs Inc., PO Box 745, St James, NY. 11780
+ * Contact: sales@kernellabs.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Locate candidate Ancillary Data Flags (000/3FF/3FF) in a line of 10-bit words.
+ * Most of a VANC line is blanking, so rather than testing one word at a time
+ * we compare a vector of positions at once and only return to the caller when
+ * a candidate is found. The match is deliberately as loose as isValidHeader(),
+ * first word 0..2 and the following two words 3FC..3FF, the parser performs
+ * the final validation.
+ */
+
+#include <libklvanc/vanc.h>
+
+#include "core-private.h"
+
+#include <pthread.h>
+
+#if KLVANC_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#define ADF_MATCH(w) (((w)[0] < 3) && (((w)[1] & 0x3fc) == 0x3fc) && (((w)[2] & 0x3fc) == 0x3fc))
+
+static unsigned int adf_find_c(const uint16_t *words, unsigned int start, unsigned int end)
+{
+	for (unsigned int i = start; i < end; i++) {
+		if (ADF_MATCH(words + i))
+			return i;
+	}
+	return end;
+}
+
+#if KLVANC_HAVE_X86_SIMD
+__attribute__((target("sse2")))
+static unsigned int adf_find_sse2(const uint16_t *words, unsigned int start, unsigned int end)
+{
+	const __m128i two = _mm_set1_epi16(2);
+	const __m128i mask = _mm_set1_epi16(0x3fc);
+	const __m128i zero = _mm_setzero_si128();
+	unsigned int i = start;
+
+	for (; i + 8 <= end; i += 8) {
+		__m128i w0 = _mm_loadu_si128((const __m128i *)(words + i));
+		__m128i w1 = _mm_loadu_si128((const __m128i *)(words + i + 1));
+		__m128i w2 = _mm_loadu_si128((const __m128i *)(words + i + 2));
+
+		/* Unsigned w0 <= 2, SSE2 lacks an unsigned 16bit compare */
+		__m128i m = _mm_cmpeq_epi16(_mm_subs_epu16(w0, two), zero);
+		m = _mm_and_si128(m, _mm_cmpeq_epi16(_mm_and_si128(w1, mask), mask));
+		m = _mm_and_si128(m, _mm_cmpeq_epi16(_mm_and_si128(w2, mask), mask));
+
+		unsigned int bits = _mm_movemask_epi8(m);
+		if (bits)
+			return i + (__builtin_ctz(bits) / 2);
+	}
+
+	return adf_find_c(words, i, end);
+}
+
+__attribute__((target("avx2")))
+static unsigned int adf_find_avx2(const uint16_t *words, unsigned int start, unsigned int end)
+{
+	const __m256i two = _mm256_set1_epi16(2);
+	const __m256i mask = _mm256_set1_epi16(0x3fc);
+	const __m256i zero = _mm256_setzero_si256();
+	unsigned int i = start;
+
+	for (; i + 16 <= end; i += 16) {
+		__m256i w0 = _mm256_loadu_si256((const __m256i *)(words + i));
+		__m256i w1 = _mm256_loadu_si256((const __m256i *)(words + i + 1));
+		__m256i w2 = _mm256_loadu_si256((const __m256i *)(words + i + 2));
+
+		__m256i m = _mm256_cmpeq_epi16(_mm256_subs_epu16(w0, two), zero);
+		m = _mm256_and_si256(m, _mm256_cmpeq_epi16(_mm256_and_si256(w1, mask), mask));
+		m = _mm256_and_si256(m, _mm256_cmpeq_epi16(_mm256_and_si256(w2, mask), mask));
+
+		unsigned int bits = _mm256_movemask_epi8(m);
+		if (bits)
+			return i + (__builtin_ctz(bits) / 2);
+	}
+
+	/* GCC leaves out vzeroupper on sibling calls into SSE code */
+	_mm256_zeroupper();
+	return adf_find_sse2(words, i, end);
+}
+#endif
+
+static unsigned int (*adf_find)(const uint16_t *words, unsigned int start, unsigned int end) = adf_find_c;
+static pthread_once_t adf_once = PTHREAD_ONCE_INIT;
+
+static void adf_select(void)
+{
+#if KLVANC_HAVE_X86_SIMD
+	unsigned int flags = klvanc_cpu_flags();
+	if (flags & KLVANC_CPU_AVX2)
+		adf_find = adf_find_avx2;
+	else if (flags & KLVANC_CPU_SSE2)
+		adf_find = adf_find_sse2;
+#endif
+}
+
+unsigned int klvanc_adf_find(const uint16_t *words, unsigned int start, unsigned int end)
+{
+	pthread_once(&adf_once, adf_select);
+	return adf_find(words, start, end);
+}
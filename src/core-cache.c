@@ -21,113 +21,802 @@
 
 #include <libklvanc/vanc.h>
 
+#include "core-private.h"
+
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 
-/* Maintain a static array of VANC messages, so that at any given time,
+/* Maintain a table of VANC messages, so that at any given time,
  * a user may ask "what message types have I seen on what lines?".
+ *
+ * Only the DID/SDID pairs seen in the stream have an entry, in an open addressed
+ * table keyed by did << 8 | sdid, and only the pages of lines seen within each
+ * entry are allocated. Entries, pages and tables are never moved or freed while
+ * the cache is in use, so an application can look them up from another thread
+ * without locking: the ingest thread fills in everything before publishing it.
+ *
+ * Packets are published the same way. Each line keeps a few snapshot buffers,
+ * usually two, which are never freed until the cache is. The ingest thread copies
+ * a packet into a buffer which is neither the published one nor referenced by a
+ * reader, then publishes it. A reader takes a reference and then checks that the
+ * buffer is still the published one, retrying if not; since a buffer is only
+ * rewritten while unpublished and unreferenced, a confirmed reference can't be
+ * rewritten under it.
+ *
+ * Entries, and the lines of each entry, are also linked newest first as they are
+ * first seen, for walking the cache, and every packet cached is numbered in a ring
+ * journal so a monitor can ask for just what changed. A journal slot is rewritten
+ * as a seqlock, the reader checks that its sequence number held while it copied.
+ * The timing of entries and lines is published as a seqlock too.
+ *
+ * With klvanc_cache_enable_history(), every line also logs its packets into a
+ * byte ring of its own, each record pointing back at the one before it. The
+ * writer announces how far it is about to write before writing, so a reader
+ * walking back from the newest record can tell when one has been overwritten.
  */
 
+#define CACHE_PAGES (KLVANC_CACHE_MAX_LINES / KLVANC_CACHE_PAGE_LINES)
+
+struct vanc_cache_table_s
+{
+	unsigned int size;	/* Power of two */
+	struct klvanc_cache_s **slots;
+
+	/* The smaller table this one replaced, kept until the cache is freed as a
+	 * reader may still be probing it.
+	 */
+	struct vanc_cache_table_s *retired;
+};
+
+struct vanc_cache_journal_s
+{
+	uint64_t seq;
+	uint64_t change;	/* type << 32 | did << 24 | sdid << 16 | lineNr */
+};
+
+#define HISTORY_NONE UINT64_MAX
+
+struct klvanc_cache_history_ring_s
+{
+	uint64_t size;		/* Bytes of data, power of two */
+	uint64_t reserve;	/* End of the record being written, data before reserve - size is gone */
+	uint64_t head;		/* End of the last record */
+	uint64_t last;		/* Start of the last record, HISTORY_NONE before the first */
+	uint8_t data[];
+};
+
+/* Followed by the raw words, records start 8 byte aligned and never wrap */
+struct vanc_cache_record_s
+{
+	uint64_t timeNs;
+	uint64_t frame;
+	uint64_t prev;
+	uint32_t words;
+	uint32_t bytes;
+};
+
+struct vanc_cache_s
+{
+	struct vanc_cache_table_s *table;
+	unsigned int count;
+	struct klvanc_cache_s *seen;
+
+	uint64_t seq;
+	struct vanc_cache_journal_s journal[KLVANC_CACHE_JOURNAL_SIZE];
+
+	uint64_t frames;
+
+	/* lastUpdated is derived from the monotonic clock, from when the cache was enabled */
+	uint64_t wallBaseNs;
+	uint64_t monoBaseNs;
+
+	/* See klvanc_cache_enable_history(), depth is 0 while disabled */
+	unsigned int historyDepth;
+	size_t historyBudget;
+	size_t historyUsed;
+	uint64_t historyDropped;
+
+	/* Handed out for the DID/SDID pairs not seen yet */
+	struct klvanc_cache_s empty;
+};
+
+static unsigned int cache_slot(const struct vanc_cache_table_s *t, uint32_t key)
+{
+	return (unsigned int)((key * 0x9E3779B185EBCA87ULL) >> 32) & (t->size - 1);
+}
+
+static struct klvanc_cache_s *cache_find(const struct vanc_cache_table_s *t, uint32_t did, uint32_t sdid)
+{
+	unsigned int i = cache_slot(t, did << 8 | sdid);
+	struct klvanc_cache_s *e;
+
+	while ((e = __atomic_load_n(&t->slots[i], __ATOMIC_ACQUIRE))) {
+		if (e->did == did && e->sdid == sdid)
+			return e;
+		i = (i + 1) & (t->size - 1);
+	}
+
+	return NULL;
+}
+
+static void cache_place(struct vanc_cache_table_s *t, struct klvanc_cache_s *e)
+{
+	unsigned int i = cache_slot(t, e->did << 8 | e->sdid);
+
+	while (t->slots[i])
+		i = (i + 1) & (t->size - 1);
+	__atomic_store_n(&t->slots[i], e, __ATOMIC_RELEASE);
+}
+
+static struct vanc_cache_table_s *cache_table_alloc(struct klvanc_context_s *ctx, unsigned int size)
+{
+	struct vanc_cache_table_s *t = calloc(1, sizeof(*t));
+	if (!t)
+		return NULL;
+
+	t->size = size;
+	t->slots = calloc(size, sizeof(*t->slots));
+	if (!t->slots) {
+		free(t);
+		return NULL;
+	}
+	getPrivate(ctx)->stats.allocations += 2;
+
+	return t;
+}
+
+/* Keep the table at most half full, so probes stay short */
+static int cache_grow(struct klvanc_context_s *ctx, struct vanc_cache_s *c)
+{
+	struct vanc_cache_table_s *t = c->table;
+	struct vanc_cache_table_s *grown = cache_table_alloc(ctx, t->size * 2);
+	if (!grown)
+		return -ENOMEM;
+
+	for (unsigned int i = 0; i < t->size; i++) {
+		if (t->slots[i])
+			cache_place(grown, t->slots[i]);
+	}
+	grown->retired = t;
+	__atomic_store_n(&c->table, grown, __ATOMIC_RELEASE);
+
+	return KLAPI_OK;
+}
+
+static struct klvanc_cache_s *cache_insert(struct klvanc_context_s *ctx, struct vanc_cache_s *c,
+					   uint32_t did, uint32_t sdid)
+{
+	if ((c->count + 1) * 2 > c->table->size && cache_grow(ctx, c) < 0)
+		return NULL;
+
+	struct klvanc_cache_s *e = calloc(1, sizeof(*e));
+	if (!e)
+		return NULL;
+	getPrivate(ctx)->stats.allocations++;
+
+	e->did = did;
+	e->sdid = sdid;
+	e->desc = klvanc_didLookupDescription(did, sdid);
+	e->spec = klvanc_didLookupSpecification(did, sdid);
+	cache_place(c->table, e);
+	c->count++;
+	e->next = c->seen;
+	__atomic_store_n(&c->seen, e, __ATOMIC_RELEASE);
+
+	return e;
+}
+
+static struct klvanc_cache_line_s *cache_page_alloc(struct klvanc_context_s *ctx, struct klvanc_cache_s *e,
+						    unsigned int page)
+{
+	struct klvanc_cache_line_s *lines = calloc(KLVANC_CACHE_PAGE_LINES, sizeof(*lines));
+	if (!lines)
+		return NULL;
+	getPrivate(ctx)->stats.allocations++;
+
+	for (int l = 0; l < KLVANC_CACHE_PAGE_LINES; l++) {
+		lines[l].lineNr = (page * KLVANC_CACHE_PAGE_LINES) + l;
+		pthread_mutex_init(&lines[l].mutex, NULL);
+	}
+	__atomic_store_n(&e->pages[page], lines, __ATOMIC_RELEASE);
+
+	return lines;
+}
+
+#define TIMING_WEIGHT 16
+
+static void cache_timing_update(struct klvanc_cache_timing_s *t, int restart, uint64_t now, uint64_t frame)
+{
+	uint32_t seq = t->seq;
+	__atomic_store_n(&t->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	if (restart) {
+		t->firstSeenNs = now;
+		t->intervalNs = 0;
+		t->jitterNs = 0;
+		t->minIntervalNs = 0;
+		t->maxIntervalNs = 0;
+	} else {
+		uint64_t interval = now - t->lastSeenNs;
+		if (!t->intervalNs) {
+			t->intervalNs = interval;
+			t->minIntervalNs = interval;
+			t->maxIntervalNs = interval;
+		} else {
+			int64_t diff = (int64_t)(interval - t->intervalNs);
+			int64_t deviation = diff < 0 ? -diff : diff;
+			t->intervalNs += diff / TIMING_WEIGHT;
+			t->jitterNs += (deviation - (int64_t)t->jitterNs) / TIMING_WEIGHT;
+			if (interval < t->minIntervalNs)
+				t->minIntervalNs = interval;
+			if (interval > t->maxIntervalNs)
+				t->maxIntervalNs = interval;
+		}
+	}
+	t->lastSeenNs = now;
+	t->lastFrame = frame;
+
+	__atomic_store_n(&t->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void klvanc_cache_timing_read(const struct klvanc_cache_timing_s *timing, struct klvanc_cache_timing_s *copy)
+{
+	uint32_t seq;
+
+	do {
+		while ((seq = __atomic_load_n(&timing->seq, __ATOMIC_ACQUIRE)) & 1)
+			;
+		*copy = *timing;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(&timing->seq, __ATOMIC_RELAXED) != seq);
+	copy->seq = seq;
+}
+
+static void cache_journal(struct vanc_cache_s *c, enum klvanc_cache_change_e type,
+			  const struct klvanc_packet_header_s *pkt)
+{
+	uint64_t seq = c->seq + 1;
+	struct vanc_cache_journal_s *j = &c->journal[seq % KLVANC_CACHE_JOURNAL_SIZE];
+
+	__atomic_store_n(&j->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&j->change, ((uint64_t)type << 32) | ((uint64_t)pkt->did << 24) | (pkt->dbnsdid << 16) | pkt->lineNr,
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&j->seq, seq, __ATOMIC_RELEASE);
+	__atomic_store_n(&c->seq, seq, __ATOMIC_RELEASE);
+}
+
+/* A line's ring holds depth records like its first, twice over */
+static struct klvanc_cache_history_ring_s *cache_history_alloc(struct klvanc_context_s *ctx,
+							       struct vanc_cache_s *c, uint32_t bytes)
+{
+	uint64_t size = 256;
+	while (size < (uint64_t)bytes * 2 * c->historyDepth)
+		size <<= 1;
+
+	size_t total = sizeof(struct klvanc_cache_history_ring_s) + size;
+	if (c->historyUsed + total > c->historyBudget)
+		return NULL;
+
+	struct klvanc_cache_history_ring_s *h = malloc(total);
+	if (!h)
+		return NULL;
+	getPrivate(ctx)->stats.allocations++;
+
+	h->size = size;
+	h->reserve = 0;
+	h->head = 0;
+	h->last = HISTORY_NONE;
+	__atomic_store_n(&c->historyUsed, c->historyUsed + total, __ATOMIC_RELAXED);
+
+	return h;
+}
+
+static void cache_history_record(struct klvanc_context_s *ctx, struct vanc_cache_s *c,
+				 struct klvanc_cache_line_s *line, const struct klvanc_packet_header_s *pkt,
+				 uint64_t now)
+{
+	struct klvanc_cache_history_ring_s *h = line->history;
+	uint32_t bytes = (sizeof(struct vanc_cache_record_s) + (pkt->rawLengthWords * sizeof(uint16_t)) + 7) & ~7;
+
+	if (!h) {
+		h = cache_history_alloc(ctx, c, bytes);
+		if (h)
+			__atomic_store_n(&line->history, h, __ATOMIC_RELEASE);
+	}
+	if (!h || bytes > h->size) {
+		__atomic_store_n(&c->historyDropped, c->historyDropped + 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	uint64_t pos = h->head;
+	uint64_t offset = pos & (h->size - 1);
+	if (offset + bytes > h->size) {
+		pos += h->size - offset;
+		offset = 0;
+	}
+
+	__atomic_store_n(&h->reserve, pos + bytes, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	struct vanc_cache_record_s r = { now, c->frames, h->last, pkt->rawLengthWords, bytes };
+	memcpy(h->data + offset, &r, sizeof(r));
+	memcpy(h->data + offset + sizeof(r), pkt->raw, pkt->rawLengthWords * sizeof(uint16_t));
+
+	__atomic_store_n(&h->last, pos, __ATOMIC_RELEASE);
+	__atomic_store_n(&h->head, pos + bytes, __ATOMIC_RELEASE);
+}
+
+/* A buffer of line to copy the next packet into. With the line mutex held, see
+ * klvanc_cache_line_s, no one is looking at a buffer through line->pkt, so any buffer
+ * no reader holds will do. Otherwise, or when every buffer is held, a new one is added.
+ */
+static struct klvanc_cache_snapshot_s *cache_buffer_claim(struct klvanc_context_s *ctx,
+							  struct klvanc_cache_line_s *line, int *locked)
+{
+	*locked = pthread_mutex_trylock(&line->mutex) == 0;
+	if (*locked) {
+		struct klvanc_cache_snapshot_s *current = __atomic_load_n(&line->current, __ATOMIC_SEQ_CST);
+		for (struct klvanc_cache_snapshot_s *b = line->buffers; b; b = b->next) {
+			if (b != current && __atomic_load_n(&b->refs, __ATOMIC_SEQ_CST) == 0)
+				return b;
+		}
+	}
+
+	struct klvanc_cache_snapshot_s *b = calloc(1, sizeof(*b));
+	if (!b)
+		return NULL;
+	getPrivate(ctx)->stats.allocations++;
+
+	b->next = line->buffers;
+	line->buffers = b;
+
+	return b;
+}
+
+/* Copy pkt into b, growing its storage if the packet doesn't fit */
+static int cache_buffer_fill(struct klvanc_context_s *ctx, struct klvanc_cache_snapshot_s *b,
+			     struct klvanc_packet_header_s *pkt)
+{
+	unsigned int words = pkt->rawLengthWords;
+	if (words < pkt->payloadLengthWords)
+		words = pkt->payloadLengthWords;
+
+	if (!b->pkt || b->pkt->allocLengthWords < words) {
+		klvanc_packet_free(b->pkt);
+		b->pkt = NULL;
+		if (klvanc_packet_alloc(&b->pkt, pkt, words) < 0)
+			return -ENOMEM;
+		getPrivate(ctx)->stats.allocations++;
+	}
+
+	struct klvanc_packet_header_s *p = b->pkt;
+	unsigned short *raw = p->raw;
+	unsigned int alloc = p->allocLengthWords;
+
+	*p = *pkt;
+	p->raw = raw;
+	p->payload = raw + alloc;
+	p->allocLengthWords = alloc;
+	memcpy(p->raw, pkt->raw, pkt->rawLengthWords * sizeof(unsigned short));
+	memcpy(p->payload, pkt->payload, pkt->payloadLengthWords * sizeof(unsigned short));
+
+	return 0;
+}
+
 int klvanc_cache_alloc(struct klvanc_context_s *ctx)
 {
-	ctx->cacheLines = calloc(0x10000, sizeof(struct klvanc_cache_s));
-    if (!ctx->cacheLines)
-        return -1;
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	if (priv->cache)
+		return 0;
+
+	struct vanc_cache_s *c = calloc(1, sizeof(*c));
+	if (!c)
+		return -1;
+
+	c->table = cache_table_alloc(ctx, 16);
+	if (!c->table) {
+		free(c);
+		return -1;
+	}
 
-    return 0;
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	c->wallBaseNs = ((uint64_t)tv.tv_sec * 1000000000ULL) + (tv.tv_usec * 1000ULL);
+	c->monoBaseNs = klvanc_stats_clock();
+	priv->stats.allocations++;
+	priv->cache = c;
+
+	return 0;
 }
 
 void klvanc_cache_free(struct klvanc_context_s *ctx)
 {
-    /* Free any cached lines otherwise we'll memory leak. */
-    klvanc_cache_reset(ctx);
+	struct vanc_cache_s *c = getPrivate(ctx)->cache;
+	if (!c)
+		return;
+
+	struct vanc_cache_table_s *t = c->table;
+	for (unsigned int i = 0; i < t->size; i++) {
+		struct klvanc_cache_s *e = t->slots[i];
+		if (!e)
+			continue;
+		for (int p = 0; p < CACHE_PAGES; p++) {
+			if (!e->pages[p])
+				continue;
+			for (int l = 0; l < KLVANC_CACHE_PAGE_LINES; l++) {
+				struct klvanc_cache_line_s *line = &e->pages[p][l];
+				while (line->buffers) {
+					struct klvanc_cache_snapshot_s *b = line->buffers;
+					line->buffers = b->next;
+					klvanc_packet_free(b->pkt);
+					free(b);
+				}
+				free(line->history);
+				pthread_mutex_destroy(&line->mutex);
+			}
+			free(e->pages[p]);
+		}
+		free(e);
+	}
 
-    if (ctx->cacheLines) {
-	    free(ctx->cacheLines);
-        ctx->cacheLines = 0;
-    }
+	while (t) {
+		struct vanc_cache_table_s *retired = t->retired;
+		free(t->slots);
+		free(t);
+		t = retired;
+	}
+
+	free(c);
+	getPrivate(ctx)->cache = NULL;
 }
 
 struct klvanc_cache_s * klvanc_cache_lookup(struct klvanc_context_s *ctx, uint8_t didnr, uint8_t sdidnr)
 {
-    if (!ctx)
-        return NULL;
-    if (!ctx->cacheLines)
-        return NULL;
+	if (!ctx)
+		return NULL;
+	struct vanc_cache_s *c = getPrivate(ctx)->cache;
+	if (!c)
+		return NULL;
 
-    return &ctx->cacheLines[ (((didnr) << 8) | (sdidnr)) ];
-};
+	struct klvanc_cache_s *e = cache_find(__atomic_load_n(&c->table, __ATOMIC_ACQUIRE), didnr, sdidnr);
+
+	return e ? e : &c->empty;
+}
+
+struct klvanc_cache_line_s * klvanc_cache_lookup_line(struct klvanc_cache_s *e, unsigned int lineNr)
+{
+	if (!e || lineNr >= KLVANC_CACHE_MAX_LINES)
+		return NULL;
+
+	struct klvanc_cache_line_s *lines = __atomic_load_n(&e->pages[lineNr / KLVANC_CACHE_PAGE_LINES],
+							    __ATOMIC_ACQUIRE);
+
+	return lines ? &lines[lineNr % KLVANC_CACHE_PAGE_LINES] : NULL;
+}
 
 int klvanc_cache_update(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *pkt)
 {
-    if (!ctx)
-        return -1;
-    if (!ctx->cacheLines)
-        return -1;
+	if (!ctx)
+		return -1;
+	struct vanc_cache_s *c = getPrivate(ctx)->cache;
+	if (!c)
+		return -1;
 	if (pkt->did > 0xff)
 		return -1;
 	if (pkt->dbnsdid > 0xff)
 		return -1;
-	if (pkt->lineNr >= 2048)
+	if (pkt->lineNr >= KLVANC_CACHE_MAX_LINES)
 		return -1;
 
-	struct klvanc_cache_s *s = klvanc_cache_lookup(ctx, pkt->did, pkt->dbnsdid);
-	if (s->activeCount == 0) {
-		s->did = pkt->did;
-		s->sdid = pkt->dbnsdid;
-		s->desc = klvanc_didLookupDescription(pkt->did, pkt->dbnsdid);
-		s->spec = klvanc_didLookupSpecification(pkt->did, pkt->dbnsdid);
+	struct klvanc_cache_s *s = cache_find(c->table, pkt->did, pkt->dbnsdid);
+	if (!s)
+		s = cache_insert(ctx, c, pkt->did, pkt->dbnsdid);
+	if (!s)
+		return -ENOMEM;
+
+	unsigned int page = pkt->lineNr / KLVANC_CACHE_PAGE_LINES;
+	struct klvanc_cache_line_s *lines = s->pages[page];
+	if (!lines)
+		lines = cache_page_alloc(ctx, s, page);
+	if (!lines)
+		return -ENOMEM;
+
+	struct klvanc_cache_line_s *line = &lines[pkt->lineNr % KLVANC_CACHE_PAGE_LINES];
+	int first = line->buffers == NULL;
+	int inserted = !line->active;
+	int locked;
+	struct klvanc_cache_snapshot_s *snap = cache_buffer_claim(ctx, line, &locked);
+	if (!snap || cache_buffer_fill(ctx, snap, pkt) < 0) {
+		if (locked)
+			pthread_mutex_unlock(&line->mutex);
+		return -ENOMEM;
 	}
-	gettimeofday(&s->lastUpdated, NULL);
 
-	struct klvanc_cache_line_s *line = &s->lines[ pkt->lineNr ];
+	uint64_t now = klvanc_stats_clock();
+	uint64_t wall = c->wallBaseNs + (now - c->monoBaseNs);
+	s->lastUpdated.tv_sec = wall / 1000000000ULL;
+	s->lastUpdated.tv_usec = (wall % 1000000000ULL) / 1000;
+	cache_timing_update(&s->timing, s->activeCount == 0, now, c->frames);
+	cache_timing_update(&line->timing, !line->active, now, c->frames);
 	line->active = 1;
 	s->activeCount++;
+	line->count++;
 
-	pthread_mutex_lock(&line->mutex);
-	if (line->pkt) {
-		klvanc_packet_free(line->pkt);
-		line->pkt = 0;
-	}
-	klvanc_packet_copy(&line->pkt, pkt);
-	pthread_mutex_unlock(&line->mutex);
+	snap->count = line->count;
+	snap->updated = s->lastUpdated;
+	__atomic_store_n(&line->current, snap, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&line->pkt, snap->pkt, __ATOMIC_RELEASE);
+	if (locked)
+		pthread_mutex_unlock(&line->mutex);
 
-	line->count++;
+	if (first) {
+		line->next = s->seen;
+		__atomic_store_n(&s->seen, line, __ATOMIC_RELEASE);
+	}
+	cache_journal(c, inserted ? KLVANC_CACHE_INSERT : KLVANC_CACHE_UPDATE, pkt);
+	if (c->historyDepth)
+		cache_history_record(ctx, c, line, pkt, now);
 
 	return 0;
 }
 
+/* Visits only the entries and lines seen, which the stream decides */
 void klvanc_cache_reset(struct klvanc_context_s *ctx)
 {
-    if (!ctx)
-        return;
-    if (!ctx->cacheLines)
-        return;
+	if (!ctx)
+		return;
+	struct vanc_cache_s *c = getPrivate(ctx)->cache;
+	if (!c)
+		return;
 
-	for (int d = 0; d <= 0xff; d++) {
-		for (int s = 0; s <= 0xff; s++) {
-			struct klvanc_cache_s *e = klvanc_cache_lookup(ctx, d, s);
+	for (struct klvanc_cache_s *e = __atomic_load_n(&c->seen, __ATOMIC_ACQUIRE); e; e = e->next) {
+		if (e->activeCount == 0)
+			continue;
+		e->activeCount = 0;
 
-			if (e->activeCount == 0)
+		for (struct klvanc_cache_line_s *line = __atomic_load_n(&e->seen, __ATOMIC_ACQUIRE); line;
+		     line = line->next) {
+			if (!line->active)
 				continue;
-			e->activeCount = 0;
 
-			for (int l = 0; l < 2048; l++) {
-				struct klvanc_cache_line_s *line = &e->lines[ l ];
-				if (!line->active)
-					continue;
+			line->active = 0;
+			line->count = 0;
 
-				line->active = 0;
-				line->count = 0;
+			/* The buffers are kept for the packets to come */
+			pthread_mutex_lock(&line->mutex);
+			__atomic_store_n(&line->current, NULL, __ATOMIC_SEQ_CST);
+			__atomic_store_n(&line->pkt, NULL, __ATOMIC_RELEASE);
+			pthread_mutex_unlock(&line->mutex);
+		}
+	}
+}
 
-				pthread_mutex_lock(&line->mutex);
-				if (line->pkt) {
-					klvanc_packet_free(line->pkt);
-					line->pkt = 0;
-				}
-				pthread_mutex_unlock(&line->mutex);
-			}
+struct klvanc_cache_s * klvanc_cache_first(struct klvanc_context_s *ctx)
+{
+	if (!ctx || !getPrivate(ctx)->cache)
+		return NULL;
+
+	struct klvanc_cache_s *e = __atomic_load_n(&getPrivate(ctx)->cache->seen, __ATOMIC_ACQUIRE);
+	while (e && e->activeCount == 0)
+		e = e->next;
+
+	return e;
+}
+
+struct klvanc_cache_s * klvanc_cache_next(struct klvanc_cache_s *e)
+{
+	if (!e)
+		return NULL;
+
+	do {
+		e = e->next;
+	} while (e && e->activeCount == 0);
+
+	return e;
+}
+
+struct klvanc_cache_line_s * klvanc_cache_first_line(struct klvanc_cache_s *e)
+{
+	if (!e)
+		return NULL;
+
+	struct klvanc_cache_line_s *line = __atomic_load_n(&e->seen, __ATOMIC_ACQUIRE);
+	while (line && !line->active)
+		line = line->next;
+
+	return line;
+}
+
+struct klvanc_cache_line_s * klvanc_cache_next_line(struct klvanc_cache_line_s *line)
+{
+	if (!line)
+		return NULL;
+
+	do {
+		line = line->next;
+	} while (line && !line->active);
+
+	return line;
+}
+
+uint64_t klvanc_cache_sequence(struct klvanc_context_s *ctx)
+{
+	if (!ctx || !getPrivate(ctx)->cache)
+		return 0;
+
+	return __atomic_load_n(&getPrivate(ctx)->cache->seq, __ATOMIC_ACQUIRE);
+}
+
+int klvanc_cache_changes(struct klvanc_context_s *ctx, uint64_t since,
+			 struct klvanc_cache_change_s *changes, unsigned int max)
+{
+	VALIDATE(ctx);
+	VALIDATE(changes);
+	struct vanc_cache_s *c = getPrivate(ctx)->cache;
+	if (!c)
+		return -EINVAL;
+
+	uint64_t last = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+	if (since >= last)
+		return 0;
+	if (last - since > KLVANC_CACHE_JOURNAL_SIZE)
+		return -EOVERFLOW;
+
+	unsigned int n = 0;
+	for (uint64_t seq = since + 1; seq <= last && n < max; seq++) {
+		struct vanc_cache_journal_s *j = &c->journal[seq % KLVANC_CACHE_JOURNAL_SIZE];
+
+		uint64_t before = __atomic_load_n(&j->seq, __ATOMIC_ACQUIRE);
+		uint64_t change = __atomic_load_n(&j->change, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (before != seq || __atomic_load_n(&j->seq, __ATOMIC_RELAXED) != seq)
+			return -EOVERFLOW;
+
+		changes[n].seq = seq;
+		changes[n].type = change >> 32;
+		changes[n].did = change >> 24;
+		changes[n].sdid = change >> 16;
+		changes[n].lineNr = change;
+		n++;
+	}
+
+	return n;
+}
+
+int klvanc_cache_snapshot(struct klvanc_context_s *ctx, uint8_t didnr, uint8_t sdidnr,
+			  unsigned int lineNr, struct klvanc_cache_snapshot_s **snap)
+{
+	VALIDATE(ctx);
+	VALIDATE(snap);
+	if (!getPrivate(ctx)->cache)
+		return -EINVAL;
+
+	struct klvanc_cache_line_s *line = klvanc_cache_lookup_line(klvanc_cache_lookup(ctx, didnr, sdidnr), lineNr);
+	if (!line)
+		return -ENOENT;
+
+	for (;;) {
+		struct klvanc_cache_snapshot_s *b = __atomic_load_n(&line->current, __ATOMIC_SEQ_CST);
+		if (!b)
+			return -ENOENT;
+
+		__atomic_add_fetch(&b->refs, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&line->current, __ATOMIC_SEQ_CST) == b) {
+			*snap = b;
+			return KLAPI_OK;
+		}
+		__atomic_sub_fetch(&b->refs, 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+void klvanc_cache_snapshot_release(struct klvanc_cache_snapshot_s *snap)
+{
+	if (snap)
+		__atomic_sub_fetch(&snap->refs, 1, __ATOMIC_RELEASE);
+}
+
+uint64_t klvanc_cache_frames(struct klvanc_context_s *ctx)
+{
+	if (!ctx || !getPrivate(ctx)->cache)
+		return 0;
+
+	return __atomic_load_n(&getPrivate(ctx)->cache->frames, __ATOMIC_RELAXED);
+}
+
+void klvanc_cache_new_frame(struct klvanc_context_s *ctx)
+{
+	if (!ctx || !getPrivate(ctx)->cache)
+		return;
+
+	struct vanc_cache_s *c = getPrivate(ctx)->cache;
+	__atomic_store_n(&c->frames, c->frames + 1, __ATOMIC_RELAXED);
+}
+
+int klvanc_cache_enable_history(struct klvanc_context_s *ctx, unsigned int depth, size_t budget)
+{
+	VALIDATE(ctx);
+	struct vanc_cache_s *c = getPrivate(ctx)->cache;
+	if (!c || c->historyDepth || depth < 1 || depth > 65536)
+		return -EINVAL;
+
+	c->historyBudget = budget;
+	c->historyDepth = depth;
+
+	return KLAPI_OK;
+}
+
+int klvanc_cache_history_usage(struct klvanc_context_s *ctx, size_t *used, uint64_t *dropped)
+{
+	VALIDATE(ctx);
+	VALIDATE(used);
+	VALIDATE(dropped);
+	struct vanc_cache_s *c = getPrivate(ctx)->cache;
+	if (!c)
+		return -EINVAL;
+
+	*used = __atomic_load_n(&c->historyUsed, __ATOMIC_RELAXED);
+	*dropped = __atomic_load_n(&c->historyDropped, __ATOMIC_RELAXED);
+
+	return KLAPI_OK;
+}
+
+/* Walks back from the newest record for at most depth records, stopping at the first
+ * one overwritten or older than fromNs, then puts what it kept in time order.
+ */
+int klvanc_cache_history(struct klvanc_context_s *ctx, uint8_t didnr, uint8_t sdidnr, unsigned int lineNr,
+			 uint64_t fromNs, uint64_t toNs, struct klvanc_cache_history_s *records,
+			 unsigned int maxRecords, uint16_t *words, unsigned int maxWords)
+{
+	VALIDATE(ctx);
+	VALIDATE(records);
+	VALIDATE(words);
+	struct vanc_cache_s *c = getPrivate(ctx)->cache;
+	if (!c)
+		return -EINVAL;
+
+	struct klvanc_cache_line_s *line = klvanc_cache_lookup_line(klvanc_cache_lookup(ctx, didnr, sdidnr), lineNr);
+	struct klvanc_cache_history_ring_s *h = line ? __atomic_load_n(&line->history, __ATOMIC_ACQUIRE) : NULL;
+	if (!h)
+		return 0;
+
+	unsigned int count = 0, used = 0;
+	uint64_t pos = __atomic_load_n(&h->last, __ATOMIC_ACQUIRE);
+	for (unsigned int n = 0; n < c->historyDepth && pos != HISTORY_NONE; n++) {
+		const uint8_t *p = h->data + (pos & (h->size - 1));
+		struct vanc_cache_record_s r;
+
+		memcpy(&r, p, sizeof(r));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&h->reserve, __ATOMIC_RELAXED) > pos + h->size || r.timeNs < fromNs)
+			break;
+
+		if (r.timeNs <= toNs) {
+			if (count == maxRecords || r.words > maxWords - used)
+				break;
+			memcpy(words + used, p + sizeof(r), r.words * sizeof(uint16_t));
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&h->reserve, __ATOMIC_RELAXED) > pos + h->size)
+				break;
+
+			records[count].timeNs = r.timeNs;
+			records[count].frame = r.frame;
+			records[count].rawLengthWords = r.words;
+			records[count].raw = words + used;
+			used += r.words;
+			count++;
 		}
+		pos = r.prev;
 	}
+
+	for (unsigned int i = 0; i < count / 2; i++) {
+		struct klvanc_cache_history_s t = records[i];
+		records[i] = records[count - 1 - i];
+		records[count - 1 - i] = t;
+	}
+
+	return count;
 }
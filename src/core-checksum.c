@@ -24,6 +24,180 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <pthread.h>
+
+#if KLVANC_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/* ST 291 parity: b8 is even parity of b0-b7 and b9 is the inverse of b8. The words
+ * covered by the checksum (DID, SDID/DBN, DC and the UDW) are exactly the words which
+ * carry parity, so both are computed in a single pass over the packet.
+ *
+ * The sum is modulo 512, so it's safe to accumulate in 16 bit lanes and let them wrap.
+ * Parity of the low byte is found by folding it onto itself, shifts and xors being all
+ * that's needed, which keeps the kernels to SSE2 and AVX2.
+ */
+#define PARITY_BITS(w) (__builtin_parity((w) & 0xff) ? 0x100 : 0x200)
+
+static unsigned int checksum_parity_c(const uint16_t *words, unsigned int count, unsigned int *bad)
+{
+	unsigned int sum = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		sum += words[i];
+		*bad |= (words[i] & 0x300) ^ PARITY_BITS(words[i]);
+	}
+	return sum;
+}
+
+static void parity_generate_c(uint16_t *words, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		words[i] = (words[i] & 0xff) | PARITY_BITS(words[i]);
+}
+
+#if KLVANC_HAVE_X86_SIMD
+/* b8/b9 expected for each lane of w, 0x100 for odd parity of the low byte, else 0x200 */
+__attribute__((target("sse2")))
+static inline __m128i parity_bits_sse2(__m128i w)
+{
+	__m128i x = _mm_and_si128(w, _mm_set1_epi16(0xff));
+	x = _mm_xor_si128(x, _mm_srli_epi16(x, 4));
+	x = _mm_xor_si128(x, _mm_srli_epi16(x, 2));
+	x = _mm_xor_si128(x, _mm_srli_epi16(x, 1));
+	x = _mm_and_si128(x, _mm_set1_epi16(1));
+	return _mm_sub_epi16(_mm_set1_epi16(0x200), _mm_slli_epi16(x, 8));
+}
+
+__attribute__((target("sse2")))
+static unsigned int checksum_parity_sse2(const uint16_t *words, unsigned int count, unsigned int *bad)
+{
+	const __m128i b8b9 = _mm_set1_epi16(0x300);
+	__m128i sum = _mm_setzero_si128();
+	__m128i err = _mm_setzero_si128();
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i w = _mm_loadu_si128((const __m128i *)(words + i));
+		sum = _mm_add_epi16(sum, w);
+		err = _mm_or_si128(err, _mm_xor_si128(_mm_and_si128(w, b8b9), parity_bits_sse2(w)));
+	}
+
+	uint16_t lanes[8];
+	_mm_storeu_si128((__m128i *)lanes, sum);
+	unsigned int total = 0;
+	for (int j = 0; j < 8; j++)
+		total += lanes[j];
+	if (_mm_movemask_epi8(_mm_cmpeq_epi16(err, _mm_setzero_si128())) != 0xffff)
+		*bad = 1;
+
+	return total + checksum_parity_c(words + i, count - i, bad);
+}
+
+__attribute__((target("sse2")))
+static void parity_generate_sse2(uint16_t *words, unsigned int count)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i w = _mm_loadu_si128((const __m128i *)(words + i));
+		w = _mm_or_si128(_mm_and_si128(w, _mm_set1_epi16(0xff)), parity_bits_sse2(w));
+		_mm_storeu_si128((__m128i *)(words + i), w);
+	}
+
+	parity_generate_c(words + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i parity_bits_avx2(__m256i w)
+{
+	__m256i x = _mm256_and_si256(w, _mm256_set1_epi16(0xff));
+	x = _mm256_xor_si256(x, _mm256_srli_epi16(x, 4));
+	x = _mm256_xor_si256(x, _mm256_srli_epi16(x, 2));
+	x = _mm256_xor_si256(x, _mm256_srli_epi16(x, 1));
+	x = _mm256_and_si256(x, _mm256_set1_epi16(1));
+	return _mm256_sub_epi16(_mm256_set1_epi16(0x200), _mm256_slli_epi16(x, 8));
+}
+
+__attribute__((target("avx2")))
+static unsigned int checksum_parity_avx2(const uint16_t *words, unsigned int count, unsigned int *bad)
+{
+	const __m256i b8b9 = _mm256_set1_epi16(0x300);
+	__m256i sum = _mm256_setzero_si256();
+	__m256i err = _mm256_setzero_si256();
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m256i w = _mm256_loadu_si256((const __m256i *)(words + i));
+		sum = _mm256_add_epi16(sum, w);
+		err = _mm256_or_si256(err, _mm256_xor_si256(_mm256_and_si256(w, b8b9), parity_bits_avx2(w)));
+	}
+
+	uint16_t lanes[16];
+	_mm256_storeu_si256((__m256i *)lanes, sum);
+	unsigned int total = 0;
+	for (int j = 0; j < 16; j++)
+		total += lanes[j];
+	if (!_mm256_testz_si256(err, err))
+		*bad = 1;
+
+	/* GCC leaves out vzeroupper on sibling calls into SSE code */
+	_mm256_zeroupper();
+	return total + checksum_parity_sse2(words + i, count - i, bad);
+}
+
+__attribute__((target("avx2")))
+static void parity_generate_avx2(uint16_t *words, unsigned int count)
+{
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m256i w = _mm256_loadu_si256((const __m256i *)(words + i));
+		w = _mm256_or_si256(_mm256_and_si256(w, _mm256_set1_epi16(0xff)), parity_bits_avx2(w));
+		_mm256_storeu_si256((__m256i *)(words + i), w);
+	}
+
+	/* GCC leaves out vzeroupper on sibling calls into SSE code */
+	_mm256_zeroupper();
+	parity_generate_sse2(words + i, count - i);
+}
+#endif
+
+static unsigned int (*checksum_parity)(const uint16_t *words, unsigned int count, unsigned int *bad) = checksum_parity_c;
+static void (*parity_generate)(uint16_t *words, unsigned int count) = parity_generate_c;
+static pthread_once_t checksum_once = PTHREAD_ONCE_INIT;
+
+static void checksum_select(void)
+{
+#if KLVANC_HAVE_X86_SIMD
+	unsigned int flags = klvanc_cpu_flags();
+	if (flags & KLVANC_CPU_AVX2) {
+		checksum_parity = checksum_parity_avx2;
+		parity_generate = parity_generate_avx2;
+	} else if (flags & KLVANC_CPU_SSE2) {
+		checksum_parity = checksum_parity_sse2;
+		parity_generate = parity_generate_sse2;
+	}
+#endif
+}
+
+uint16_t klvanc_checksum_parity(const uint16_t *words, unsigned int wordCount, int *parityValid)
+{
+	unsigned int bad = 0;
+
+	pthread_once(&checksum_once, checksum_select);
+	uint16_t s = checksum_parity(words, wordCount, &bad) & 0x1ff;
+	if (parityValid)
+		*parityValid = (bad == 0);
+
+	return s | ((~s & 0x0100) << 1);
+}
+
+void klvanc_parity_generate(uint16_t *words, unsigned int wordCount)
+{
+	pthread_once(&checksum_once, checksum_select);
+	parity_generate(words, wordCount);
+}
 
 /* Wikipedia:
  * The last word in an ANC packet is the Checksum word. It is computed
@@ -41,14 +215,10 @@
  */
 uint16_t klvanc_checksum_calculate(const uint16_t *words, int wordCount)
 {
-	uint16_t s = 0;
-	for (uint16_t i = 0; i < wordCount; i++) {
-		s += *(words + i);
-		s &= 0x01ff;
-	}
-	s |= ((~s & 0x0100) << 1);
+	if (wordCount <= 0)
+		return 0x200;
 
-	return s;
+	return klvanc_checksum_parity(words, wordCount, NULL);
 }
 
 /* For a given list of words, excludint the ADF, ending in a checksum,
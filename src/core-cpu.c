@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026 Kernel Labs Inc. All Rights Reserved
+ *
+ * Address: Kernel Labs Inc., PO Box 745, St James, NY. 11780
+ * Contact: sales@kernellabs.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Runtime CPU feature detection, used to pick SIMD implementations
+ * of the hot scanning and pixel packing routines.
+ */
+
+#include <libklvanc/vanc.h>
+
+#include "core-private.h"
+
+#include <pthread.h>
+
+static pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+static unsigned int cpu_flags = 0;
+
+static void cpu_detect(void)
+{
+#if KLVANC_HAVE_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		cpu_flags |= KLVANC_CPU_SSE2;
+	if (__builtin_cpu_supports("ssse3"))
+		cpu_flags |= KLVANC_CPU_SSSE3;
+	if (__builtin_cpu_supports("avx2"))
+		cpu_flags |= KLVANC_CPU_AVX2;
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		cpu_flags |= KLVANC_CPU_AVX512;
+#endif
+}
+
+unsigned int klvanc_cpu_flags(void)
+{
+	pthread_once(&cpu_once, cpu_detect);
+	return cpu_flags;
+}
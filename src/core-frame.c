@@ -0,0 +1,760 @@
+/*
+ * Copyright (c) 2026 Kernel Labs Inc. All Rights Reserved
+ *
+ * Address: Kernel Labs Inc., PO Box 745, St James, NY. 11780
+ * Contact: sales@kernellabs.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <libklvanc/vanc.h>
+
+#include "core-private.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* Words of scratch per line, luma plus chroma is two words per pixel. Packets
+ * never overlap, so this is also the most a line's packets can occupy.
+ */
+#define FRAME_LINE_WORDS(width) ((width) * 2)
+
+/* A frame as handed to klvanc_frame_parse_format(), the second plane is only used by P210 */
+struct frame_planes_s
+{
+	enum klvanc_pixel_format_e format;
+	const uint8_t *planes[2];
+	int strides[2];
+	int width;
+	unsigned int firstLine;
+};
+
+/* Bytes per line in the frame's own layout, as reported in the scan statistics */
+static unsigned int frame_line_bytes(const struct frame_planes_s *f)
+{
+	switch (f->format) {
+	case KLVANC_PIXFMT_V210:
+		return (f->width / 6) * 16;
+	case KLVANC_PIXFMT_UYVY8:
+		return f->width * 2;
+	default:
+		return f->width * 4;
+	}
+}
+
+/* Where each sample of a stream lives within a v210 group of 6 pixels (4 LE dwords).
+ * dword 0: Cb0 Y0 Cr0, dword 1: Y1 Cb1 Y2, dword 2: Cr1 Y3 Cb2, dword 3: Y4 Cr2 Y5
+ */
+struct v210_stream_s
+{
+	unsigned int count;	/* Samples per group */
+	uint8_t dword[12];
+	uint8_t shift[12];
+};
+
+static const struct v210_stream_s stream_c = {
+	6, { 0, 0, 1, 2, 2, 3 }, { 0, 20, 10, 0, 20, 10 }
+};
+
+static inline uint16_t stream_sample(const uint32_t *src, const struct v210_stream_s *s, unsigned int n)
+{
+	unsigned int k = n % s->count;
+	return (src[(n / s->count) * 4 + s->dword[k]] >> s->shift[k]) & 0x3ff;
+}
+
+/* Packets a worker found on one line, held back for delivery in line order */
+struct frame_line_s
+{
+	struct klvanc_packet_header_s *pkts;
+	unsigned int count;
+	unsigned int alloc;
+	int done;
+
+	/* Worker side statistics, folded into the context's as the line is delivered */
+	int scanned;
+	int blank;
+	uint64_t scanNs;
+	unsigned int allocations;
+};
+
+/* Worker pool for klvanc_context_enable_threads(). Workers claim lines of the
+ * posted frame by advancing nextLine, under the mutex, and hand each to task.
+ */
+struct vanc_frame_pool_s
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t work;		/* A frame was posted, or the pool is shutting down */
+	pthread_cond_t progress;	/* A line completed */
+	pthread_t *threads;
+	int threadCount;
+	int terminate;
+
+	struct klvanc_context_s *ctx;
+	struct frame_planes_s frame;
+	unsigned int lineCount;
+	unsigned int nextLine;
+	void (*task)(void *arg, unsigned int l);
+	void *arg;
+
+	struct frame_line_s *lines;
+	unsigned int linesAlloc;
+};
+
+/* Hold back a packet for later delivery. Called from the workers, so only the
+ * line itself is touched.
+ */
+static int frame_line_add(struct frame_line_s *line, unsigned int lineNr, unsigned int horizontalOffset,
+			  const uint16_t *arr, unsigned int len)
+{
+	if (line->count == line->alloc) {
+		unsigned int n = line->alloc ? line->alloc * 2 : 8;
+		struct klvanc_packet_header_s *p = realloc(line->pkts, n * sizeof(*p));
+		if (!p)
+			return -ENOMEM;
+		line->pkts = p;
+		line->alloc = n;
+		line->allocations++;
+	}
+
+	struct klvanc_packet_header_s *hdr = &line->pkts[line->count];
+	int ret = klvanc_packet_view(arr, len, hdr);
+	if (ret < 0)
+		return ret;
+
+	hdr->lineNr = lineNr;
+	hdr->horizontalOffset = horizontalOffset;
+	line->count++;
+
+	return KLAPI_OK;
+}
+
+/* Scan one sample stream of a packed v210 line for packets, without unpacking it.
+ * Only the words of packets actually found are extracted, into dst, which must
+ * have room for every sample of the stream. offset is added to the horizontal
+ * offset reported for each packet. Packets are processed as they're found, or
+ * held back in line if one is given.
+ */
+static int frame_scan_stream(struct klvanc_context_s *ctx, unsigned int lineNr,
+			     const uint32_t *src, unsigned int groups, const struct v210_stream_s *s,
+			     unsigned int offset, uint16_t *dst, unsigned int *used,
+			     struct frame_line_s *line)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	unsigned int samples = groups * s->count;
+	unsigned int next = 0;
+	int attempts = 0;
+
+	if (samples < 8)
+		return 0;
+
+	for (unsigned int g = 0; g < groups; g++) {
+		const uint32_t *grp = src + (g * 4);
+		for (unsigned int k = 0; k < s->count; k++) {
+			/* Nearly every sample is blanking, reject with a single extraction */
+			if (((grp[s->dword[k]] >> s->shift[k]) & 0x3ff) >= 3)
+				continue;
+
+			unsigned int n = (g * s->count) + k;
+			if (n < next || n >= samples - 7)
+				continue;
+			if ((stream_sample(src, s, n + 1) & 0x3fc) != 0x3fc ||
+			    (stream_sample(src, s, n + 2) & 0x3fc) != 0x3fc)
+				continue;
+
+			unsigned int words = sanitizeWord(stream_sample(src, s, n + 5)) + 7;
+			if (!klvanc_packet_subscribed(priv, stream_sample(src, s, n + 3), stream_sample(src, s, n + 4))) {
+				next = n + words;
+				continue;
+			}
+			if (n + words > samples)
+				continue;
+
+			/* Materialize just this packet. Keep it if the frame callback will need it. */
+			uint16_t *pkt = dst + *used;
+			for (unsigned int i = 0; i < words; i++)
+				pkt[i] = stream_sample(src, s, n + i);
+
+			if (line) {
+				/* Delivered later, so the words always have to persist */
+				if (frame_line_add(line, lineNr, offset + n, pkt, words) < 0)
+					continue;
+				*used += words;
+			} else {
+				if (klvanc_packet_process(ctx, lineNr, offset + n, pkt, words) < 0)
+					continue;
+				if (priv->frameCollect)
+					*used += words;
+			}
+
+			attempts++;
+			next = n + words;
+		}
+	}
+
+	return attempts;
+}
+
+/* Scan a line of words for packets, as per klvanc_packet_parse(). offset is
+ * added to the horizontal offset reported for each packet. Packets are
+ * processed as they're found, or held back in line if one is given.
+ */
+static int frame_scan_words(struct klvanc_context_s *ctx, unsigned int lineNr, const uint16_t *arr,
+			    unsigned int len, unsigned int offset, struct frame_line_s *line)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	int attempts = 0;
+
+	if (len < 8)
+		return 0;
+
+	unsigned int i = 0;
+	while (i < len - 7) {
+		i = klvanc_adf_find(arr, i, len - 7);
+		if (i >= len - 7)
+			break;
+
+		if (!klvanc_packet_subscribed(priv, arr[i + 3], arr[i + 4])) {
+			i += sanitizeWord(arr[i + 5]) + 7;
+			continue;
+		}
+
+		int words;
+		if (line) {
+			words = frame_line_add(line, lineNr, offset + i, arr + i, len - i);
+			if (words == KLAPI_OK)
+				words = line->pkts[line->count - 1].rawLengthWords;
+		} else
+			words = klvanc_packet_process(ctx, lineNr, offset + i, arr + i, len - i);
+		if (words < 0) {
+			i++;
+			continue;
+		}
+
+		attempts++;
+		i += words;
+	}
+
+	return attempts;
+}
+
+/* Turn the 8 bit ANC packets of a widened UYVY8 line back into 10 bit words, in
+ * place, ahead of the regular scan. Only b7-b0 survive 8 bit capture, so parity
+ * is regenerated and the checksum keeps its received low 8 bits, gaining the b8
+ * and b9 of the computed sum.
+ */
+static void frame_narrow_words(uint16_t *arr, unsigned int len)
+{
+	if (len < 8)
+		return;
+
+	unsigned int i = 0;
+	while (i < len - 7) {
+		i = klvanc_adf_find(arr, i, len - 7);
+		if (i >= len - 7)
+			break;
+
+		unsigned int words = (arr[i + 5] >> 2) + 7;
+		if (i + words > len) {
+			i++;
+			continue;
+		}
+
+		uint16_t *pkt = arr + i;
+		pkt[0] = 0x000;
+		pkt[1] = 0x3ff;
+		pkt[2] = 0x3ff;
+		for (unsigned int k = 3; k < words; k++)
+			pkt[k] >>= 2;
+		klvanc_parity_generate(pkt + 3, words - 4);
+		pkt[words - 1] = (pkt[words - 1] & 0xff) | (klvanc_checksum_parity(pkt + 3, words - 4, NULL) & 0x300);
+
+		i += words;
+	}
+}
+
+/* The blank line pre-check, on line l in the frame's own layout. 8 bit ADF
+ * words are FF, 16 bit ones have bits 9-2 set, shifted up 6 bits for P210.
+ */
+static int frame_line_has_anc(const struct frame_planes_s *f, unsigned int l)
+{
+	const uint8_t *src = f->planes[0] + ((size_t)l * f->strides[0]);
+
+	switch (f->format) {
+	case KLVANC_PIXFMT_V210:
+		return klvanc_v210_line_has_anc((const uint32_t *)src, f->width);
+	case KLVANC_PIXFMT_UYVY8:
+		return memchr(src, 0xff, f->width * 2) != NULL;
+	case KLVANC_PIXFMT_UYVY16:
+		return klvanc_words_have_anc((const uint16_t *)src, f->width * 2, 0x3fc);
+	case KLVANC_PIXFMT_P210:
+		return klvanc_words_have_anc((const uint16_t *)src, f->width, 0x3fc << 6) ||
+		       klvanc_words_have_anc((const uint16_t *)(f->planes[1] + ((size_t)l * f->strides[1])),
+					     f->width, 0x3fc << 6);
+	}
+
+	return 1;
+}
+
+/* Scan line l of the frame, converting it from its native layout into scratch at
+ * base + *used as needed. *used only advances past words that have to persist,
+ * because packets are held back in line or the frame callback will need them.
+ */
+static int frame_scan_line(struct klvanc_context_s *ctx, const struct frame_planes_s *f, unsigned int l,
+			   uint16_t *base, unsigned int *used, struct frame_line_s *line)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	const uint8_t *src = f->planes[0] + ((size_t)l * f->strides[0]);
+	unsigned int lineNr = f->firstLine + l;
+	unsigned int width = f->width;
+	uint16_t *dst = base + *used;
+	int keep = line || priv->frameCollect;
+	int attempts = 0;
+
+	/* HD carries ANC in separate Y and C streams, chroma offsets follow luma as
+	 * if the line were nv20. SD carries ANC in the multiplexed stream.
+	 */
+	int hd = width > 720;
+
+	switch (f->format) {
+	case KLVANC_PIXFMT_V210:
+		if (hd) {
+			/* Nearly all ANC is in luma, so only luma is unpacked and the
+			 * rarely used chroma stream is walked in place.
+			 */
+			klvanc_v210_line_to_y10((const uint32_t *)src, dst, width);
+			attempts = frame_scan_words(ctx, lineNr, dst, width, 0, line);
+			if (keep)
+				*used += width;
+			attempts += frame_scan_stream(ctx, lineNr, (const uint32_t *)src, width / 6, &stream_c,
+						      width, base, used, line);
+			return attempts;
+		}
+		klvanc_v210_line_to_uyvy((const uint32_t *)src, dst, width);
+		break;
+	case KLVANC_PIXFMT_UYVY8:
+		if (hd) {
+			klvanc_uyvy8_split(src, dst, dst + width, width);
+			frame_narrow_words(dst, width);
+			frame_narrow_words(dst + width, width);
+		} else {
+			klvanc_uyvy8_expand(src, dst, width * 2);
+			frame_narrow_words(dst, width * 2);
+		}
+		break;
+	case KLVANC_PIXFMT_UYVY16:
+		if (!hd) {
+			/* Already a line of words, scan the caller's buffer directly */
+			return frame_scan_words(ctx, lineNr, (const uint16_t *)src, width * 2, 0, line);
+		}
+		klvanc_uyvy16_split((const uint16_t *)src, dst, dst + width, width);
+		break;
+	case KLVANC_PIXFMT_P210: {
+		const uint16_t *c = (const uint16_t *)(f->planes[1] + ((size_t)l * f->strides[1]));
+		if (hd) {
+			klvanc_p210_shift((const uint16_t *)src, dst, width);
+			klvanc_p210_shift(c, dst + width, width);
+		} else
+			klvanc_p210_merge((const uint16_t *)src, c, dst, width);
+		break;
+	}
+	}
+
+	if (hd) {
+		attempts = frame_scan_words(ctx, lineNr, dst, width, 0, line);
+		attempts += frame_scan_words(ctx, lineNr, dst + width, width, width, line);
+	} else
+		attempts = frame_scan_words(ctx, lineNr, dst, width * 2, 0, line);
+	if (keep)
+		*used += width * 2;
+
+	return attempts;
+}
+
+/* Worker side of a line. Each line owns its own slice of the frame scratch, so
+ * any number of lines can be scanned at once.
+ */
+static void frame_pool_scan(void *arg, unsigned int l)
+{
+	struct vanc_frame_pool_s *pool = arg;
+	struct klvanc_context_s *ctx = pool->ctx;
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	struct frame_line_s *line = &pool->lines[l];
+	uint16_t *base = priv->frameWords + ((size_t)l * FRAME_LINE_WORDS(pool->frame.width));
+	unsigned int used = 0;
+
+	line->count = 0;
+	line->scanned = 0;
+	line->allocations = 0;
+	if (!klvanc_line_subscribed(priv, pool->frame.firstLine + l))
+		return;
+
+	uint64_t begin = klvanc_stats_begin(ctx);
+
+	line->blank = !frame_line_has_anc(&pool->frame, l);
+	if (!line->blank)
+		frame_scan_line(ctx, &pool->frame, l, base, &used, line);
+
+	line->scanned = 1;
+	line->scanNs = begin ? klvanc_stats_clock() - begin : 0;
+}
+
+/* Claim and run the next unclaimed line. Called, and returns, with the mutex held. */
+static void frame_pool_run(struct vanc_frame_pool_s *pool)
+{
+	unsigned int l = pool->nextLine++;
+
+	pthread_mutex_unlock(&pool->mutex);
+	pool->task(pool->arg, l);
+	pthread_mutex_lock(&pool->mutex);
+
+	pool->lines[l].done = 1;
+	pthread_cond_broadcast(&pool->progress);
+}
+
+static void *frame_pool_thread(void *p)
+{
+	struct vanc_frame_pool_s *pool = p;
+
+	pthread_mutex_lock(&pool->mutex);
+	while (!pool->terminate) {
+		if (pool->nextLine < pool->lineCount)
+			frame_pool_run(pool);
+		else
+			pthread_cond_wait(&pool->work, &pool->mutex);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+static void frame_pool_destroy(struct vanc_frame_pool_s *pool)
+{
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->terminate = 1;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (int i = 0; i < pool->threadCount; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	for (unsigned int l = 0; l < pool->linesAlloc; l++)
+		free(pool->lines[l].pkts);
+	free(pool->lines);
+	free(pool->threads);
+	pthread_cond_destroy(&pool->progress);
+	pthread_cond_destroy(&pool->work);
+	pthread_mutex_destroy(&pool->mutex);
+	free(pool);
+}
+
+static struct vanc_frame_pool_s *frame_pool_create(int threads)
+{
+	struct vanc_frame_pool_s *pool = calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+
+	pool->threads = calloc(threads, sizeof(pthread_t));
+	if (!pool->threads) {
+		free(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->progress, NULL);
+
+	for (int i = 0; i < threads; i++) {
+		if (pthread_create(&pool->threads[i], NULL, frame_pool_thread, pool) != 0) {
+			frame_pool_destroy(pool);
+			return NULL;
+		}
+		pool->threadCount++;
+	}
+
+	return pool;
+}
+
+static int frame_parse_serial(struct klvanc_context_s *ctx, const struct frame_planes_s *f,
+			      unsigned int line_count)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+
+	/* Scratch is consumed as lines are converted and chroma packets are found,
+	 * and only when the frame callback needs the words to persist.
+	 */
+	unsigned int used = 0;
+	int attempts = 0;
+	for (unsigned int l = 0; l < line_count; l++) {
+		if (!klvanc_line_subscribed(priv, f->firstLine + l))
+			continue;
+
+		uint64_t begin = klvanc_stats_begin(ctx);
+		uint64_t deliverNs = priv->stats.deliverNs;
+
+		/* Most lines are pure blanking, one streaming read rules them out */
+		int blank = !frame_line_has_anc(f, l);
+		if (!blank)
+			attempts += frame_scan_line(ctx, f, l, priv->frameWords, &used, NULL);
+
+		if (begin) {
+			klvanc_stats_scan(ctx, begin, deliverNs, frame_line_bytes(f));
+			priv->stats.linesBlank += blank;
+		}
+	}
+
+	return attempts;
+}
+
+/* Post the frame to the workers, then deliver each line in order as soon as
+ * it completes. Everything that touches context state, the cache, the decoders
+ * (SCTE-104 reassembly in particular) and the callbacks, happens here on the
+ * caller's thread. The caller scans lines too, rather than sit idle.
+ */
+/* Hand line_count lines to the workers. Returns with the mutex held. */
+static int frame_pool_post(struct klvanc_context_s *ctx, unsigned int line_count,
+			   void (*task)(void *arg, unsigned int l), void *arg)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	struct vanc_frame_pool_s *pool = priv->pool;
+
+	if (line_count > pool->linesAlloc) {
+		struct frame_line_s *p = realloc(pool->lines, line_count * sizeof(*p));
+		if (!p)
+			return -ENOMEM;
+		memset(p + pool->linesAlloc, 0, (line_count - pool->linesAlloc) * sizeof(*p));
+		pool->lines = p;
+		pool->linesAlloc = line_count;
+		priv->stats.allocations++;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->ctx = ctx;
+	pool->task = task;
+	pool->arg = arg;
+	for (unsigned int l = 0; l < line_count; l++)
+		pool->lines[l].done = 0;
+	pool->nextLine = 0;
+	pool->lineCount = line_count;
+	pthread_cond_broadcast(&pool->work);
+
+	return 0;
+}
+
+static int frame_parse_threaded(struct klvanc_context_s *ctx, const struct frame_planes_s *f,
+				unsigned int line_count)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	struct vanc_frame_pool_s *pool = priv->pool;
+	int attempts = 0;
+
+	pool->frame = *f;
+	if (frame_pool_post(ctx, line_count, frame_pool_scan, pool) < 0)
+		return -ENOMEM;
+
+	for (unsigned int l = 0; l < line_count; l++) {
+		struct frame_line_s *line = &pool->lines[l];
+
+		while (!line->done) {
+			if (pool->nextLine < pool->lineCount)
+				frame_pool_run(pool);
+			else
+				pthread_cond_wait(&pool->progress, &pool->mutex);
+		}
+
+		pthread_mutex_unlock(&pool->mutex);
+		priv->stats.allocations += line->allocations;
+		if (line->scanned && priv->stats.enabled) {
+			klvanc_stats_scanned(ctx, line->scanNs, frame_line_bytes(f));
+			priv->stats.linesBlank += line->blank;
+		}
+		for (unsigned int i = 0; i < line->count; i++) {
+			klvanc_packet_deliver(ctx, &line->pkts[i]);
+			attempts++;
+		}
+		pthread_mutex_lock(&pool->mutex);
+	}
+
+	pool->lineCount = 0;
+	pool->nextLine = 0;
+	pthread_mutex_unlock(&pool->mutex);
+
+	return attempts;
+}
+
+int klvanc_frame_pool_for(struct klvanc_context_s *ctx, unsigned int count,
+			  void (*task)(void *arg, unsigned int n), void *arg)
+{
+	struct vanc_frame_pool_s *pool = getPrivate(ctx)->pool;
+
+	if (!pool)
+		return -EINVAL;
+	if (frame_pool_post(ctx, count, task, arg) < 0)
+		return -ENOMEM;
+
+	for (unsigned int l = 0; l < count; l++) {
+		while (!pool->lines[l].done) {
+			if (pool->nextLine < pool->lineCount)
+				frame_pool_run(pool);
+			else
+				pthread_cond_wait(&pool->progress, &pool->mutex);
+		}
+	}
+
+	pool->lineCount = 0;
+	pool->nextLine = 0;
+	pthread_mutex_unlock(&pool->mutex);
+
+	return 0;
+}
+
+int klvanc_context_enable_threads(struct klvanc_context_s *ctx, int threads)
+{
+	VALIDATE(ctx);
+	if (threads < 0 || threads > KLVANC_MAX_THREADS)
+		return -EINVAL;
+
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+
+	frame_pool_destroy(priv->pool);
+	priv->pool = NULL;
+
+	if (threads == 0)
+		return KLAPI_OK;
+
+	priv->pool = frame_pool_create(threads);
+	if (!priv->pool)
+		return -ENOMEM;
+
+	return KLAPI_OK;
+}
+
+int klvanc_frame_collect(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+
+	if (priv->framePacketCount == priv->framePacketAlloc) {
+		unsigned int n = priv->framePacketAlloc ? priv->framePacketAlloc * 2 : 32;
+		struct klvanc_packet_header_s *p = realloc(priv->framePackets, n * sizeof(*p));
+		if (!p)
+			return -ENOMEM;
+		priv->framePackets = p;
+		priv->framePacketAlloc = n;
+		priv->stats.allocations++;
+	}
+
+	priv->framePackets[priv->framePacketCount++] = *hdr;
+	return KLAPI_OK;
+}
+
+void klvanc_frame_free(struct klvanc_context_s *ctx)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+
+	frame_pool_destroy(priv->pool);
+	priv->pool = NULL;
+	free(priv->frameWords);
+	priv->frameWords = NULL;
+	priv->frameWordsAlloc = 0;
+	free(priv->framePackets);
+	priv->framePackets = NULL;
+	priv->framePacketAlloc = 0;
+	priv->framePacketCount = 0;
+}
+
+int klvanc_frame_parse_format(struct klvanc_context_s *ctx, enum klvanc_pixel_format_e format,
+			      const uint8_t *const planes[], const int strides[], int width,
+			      unsigned int first_line, unsigned int line_count, uint64_t frame_id)
+{
+	VALIDATE(ctx);
+	VALIDATE(planes);
+	VALIDATE(planes[0]);
+	VALIDATE(strides);
+	VALIDATE(line_count);
+
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	struct frame_planes_s f = { format, { planes[0], NULL }, { strides[0], 0 }, 0, first_line };
+
+	/* Widths are whole v210 groups of 6, or whole pairs of pixels */
+	switch (format) {
+	case KLVANC_PIXFMT_V210:
+		width = (width / 6) * 6;
+		break;
+	case KLVANC_PIXFMT_UYVY8:
+	case KLVANC_PIXFMT_UYVY16:
+		width &= ~1;
+		break;
+	case KLVANC_PIXFMT_P210:
+		VALIDATE(planes[1]);
+		width &= ~1;
+		f.planes[1] = planes[1];
+		f.strides[1] = strides[1];
+		if (f.strides[1] < width * 2)
+			return -EINVAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+	f.width = width;
+
+	/* P210 splits the line bytes evenly over its two planes */
+	int minStride = format == KLVANC_PIXFMT_P210 ? width * 2 : (int)frame_line_bytes(&f);
+	if (width <= 0 || f.strides[0] < minStride)
+		return -EINVAL;
+
+	/* Only grows, steady state parsing never allocates */
+	size_t words = (size_t)FRAME_LINE_WORDS(width) * line_count;
+	if (words > priv->frameWordsAlloc) {
+		uint16_t *p = realloc(priv->frameWords, words * sizeof(uint16_t));
+		if (!p)
+			return -ENOMEM;
+		priv->frameWords = p;
+		priv->frameWordsAlloc = words;
+		priv->stats.allocations++;
+	}
+
+	priv->frameId = frame_id;
+	priv->framePacketCount = 0;
+	klvanc_cache_new_frame(ctx);
+	priv->frameCollect = ctx->callbacks && ctx->callbacks->frame;
+
+	int attempts;
+	if (priv->pool && line_count > 1)
+		attempts = frame_parse_threaded(ctx, &f, line_count);
+	else
+		attempts = frame_parse_serial(ctx, &f, line_count);
+
+	if (priv->frameCollect) {
+		KLVANC_CALLBACK(ctx, ctx->callbacks->frame(ctx->callback_context, ctx, frame_id,
+							   priv->framePackets, priv->framePacketCount));
+		priv->frameCollect = 0;
+	}
+
+	return attempts;
+}
+
+int klvanc_frame_parse(struct klvanc_context_s *ctx, const uint8_t *v210, int stride, int width,
+		       unsigned int first_line, unsigned int line_count, uint64_t frame_id)
+{
+	const uint8_t *const planes[] = { v210 };
+	const int strides[] = { stride };
+
+	return klvanc_frame_parse_format(ctx, KLVANC_PIXFMT_V210, planes, strides, width,
+					 first_line, line_count, frame_id);
+}
@@ -28,6 +28,164 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* Line numbers the arena indexes directly, higher ones fall back to a scan of the set */
+#define ARENA_INDEX_LINES 4096
+
+/* Payload copies are carved from blocks of at least this many words */
+#define ARENA_BLOCK_WORDS 8192
+
+struct arena_block_s
+{
+	struct arena_block_s *next;
+	size_t size;
+	size_t used;
+	uint16_t words[];
+};
+
+/* Backing store for klvanc_line_set_create(). Every line slot owns a fixed run
+ * of entries, payload copies come from a chain of blocks that reset rewinds.
+ */
+struct klvanc_line_arena_s
+{
+	struct klvanc_line_s lines[KLVANC_MAX_VANC_LINES];
+	struct klvanc_entry_s entries[KLVANC_MAX_VANC_LINES][KLVANC_MAX_VANC_ENTRIES];
+	uint8_t index[ARENA_INDEX_LINES];	/* Slot plus one by line number, zero if absent */
+	struct arena_block_s *blocks;
+	struct arena_block_s *current;
+};
+
+static uint16_t *arena_alloc(struct klvanc_line_arena_s *arena, size_t words)
+{
+	struct arena_block_s *b = arena->current, *last = NULL;
+
+	for (; b; b = b->next) {
+		if (b->size - b->used >= words) {
+			arena->current = b;
+			b->used += words;
+			return b->words + b->used - words;
+		}
+		last = b;
+	}
+
+	/* Only reached while the arena grows to the largest frame seen */
+	size_t size = words > ARENA_BLOCK_WORDS ? words : ARENA_BLOCK_WORDS;
+	b = malloc(sizeof(*b) + (size * sizeof(uint16_t)));
+	if (!b)
+		return NULL;
+	b->next = NULL;
+	b->size = size;
+	b->used = words;
+	if (last)
+		last->next = b;
+	else if (arena->blocks) {
+		for (last = arena->blocks; last->next; last = last->next)
+			;
+		last->next = b;
+	} else
+		arena->blocks = b;
+	arena->current = b;
+
+	return b->words;
+}
+
+int klvanc_line_set_create(struct klvanc_line_set_s **set)
+{
+	if (!set)
+		return -EINVAL;
+
+	struct klvanc_line_set_s *p = calloc(1, sizeof(*p));
+	if (!p)
+		return -ENOMEM;
+
+	p->arena = calloc(1, sizeof(struct klvanc_line_arena_s));
+	if (!p->arena) {
+		free(p);
+		return -ENOMEM;
+	}
+
+	*set = p;
+	return 0;
+}
+
+void klvanc_line_set_reset(struct klvanc_line_set_s *set)
+{
+	struct klvanc_line_arena_s *arena = set->arena;
+
+	for (int i = 0; i < set->num_lines; i++) {
+		int n = set->lines[i]->line_number;
+		if (n >= 0 && n < ARENA_INDEX_LINES)
+			arena->index[n] = 0;
+		set->lines[i] = NULL;
+	}
+	set->num_lines = 0;
+
+	for (struct arena_block_s *b = arena->blocks; b; b = b->next)
+		b->used = 0;
+	arena->current = arena->blocks;
+}
+
+void klvanc_line_set_destroy(struct klvanc_line_set_s *set)
+{
+	if (!set)
+		return;
+
+	struct arena_block_s *b = set->arena->blocks;
+	while (b) {
+		struct arena_block_s *next = b->next;
+		free(b);
+		b = next;
+	}
+	free(set->arena);
+	free(set);
+}
+
+static int arena_line_insert(struct klvanc_context_s *ctx, struct klvanc_line_set_s *set,
+			     uint16_t *pixels, int pixel_width, int line_number, int horizontal_offset)
+{
+	struct klvanc_line_arena_s *arena = set->arena;
+	int slot = -1;
+
+	if (line_number >= 0 && line_number < ARENA_INDEX_LINES)
+		slot = arena->index[line_number] - 1;
+	else {
+		for (int i = 0; i < set->num_lines; i++) {
+			if (set->lines[i]->line_number == line_number)
+				slot = i;
+		}
+	}
+
+	if (slot < 0) {
+		if (set->num_lines == KLVANC_MAX_VANC_LINES) {
+			PRINT_DEBUG("array of lines is full!\n");
+			return -ENOMEM;
+		}
+		slot = set->num_lines++;
+		arena->lines[slot].line_number = line_number;
+		arena->lines[slot].num_entries = 0;
+		set->lines[slot] = &arena->lines[slot];
+		if (line_number >= 0 && line_number < ARENA_INDEX_LINES)
+			arena->index[line_number] = slot + 1;
+	}
+
+	struct klvanc_line_s *line = &arena->lines[slot];
+	if (line->num_entries == KLVANC_MAX_VANC_ENTRIES) {
+		PRINT_DEBUG("line is full!\n");
+		return -ENOMEM;
+	}
+
+	/* Generation may sort p_entries, but they stay the first num_entries of the slot's run */
+	struct klvanc_entry_s *entry = &arena->entries[slot][line->num_entries];
+	entry->payload = arena_alloc(arena, pixel_width);
+	if (!entry->payload)
+		return -ENOMEM;
+	memcpy(entry->payload, pixels, pixel_width * sizeof(uint16_t));
+	entry->h_offset = horizontal_offset;
+	entry->pixel_width = pixel_width;
+
+	line->p_entries[line->num_entries++] = entry;
+	return 0;
+}
+
 struct klvanc_line_s *klvanc_line_create(int line_number)
 {
 	struct klvanc_line_s *new_line = NULL;
@@ -54,6 +212,10 @@ int klvanc_line_insert(struct klvanc_context_s *ctx, struct klvanc_line_set_s *v
 		       uint16_t * pixels, int pixel_width, int line_number, int horizontal_offset)
 {
 	int i;
+
+	if (vanc_lines->arena)
+		return arena_line_insert(ctx, vanc_lines, pixels, pixel_width, line_number, horizontal_offset);
+
 	struct klvanc_line_s *line = vanc_lines->lines[0];
 	struct klvanc_entry_s *new_entry =
 	    (struct klvanc_entry_s *)malloc(sizeof(struct klvanc_entry_s));
@@ -74,6 +236,11 @@ int klvanc_line_insert(struct klvanc_context_s *ctx, struct klvanc_line_set_s *v
 	for (i = 0; i < KLVANC_MAX_VANC_LINES; i++) {
 		if (vanc_lines->lines[i] == NULL) {
 			line = klvanc_line_create(line_number);
+			if (line == NULL) {
+				free(new_entry->payload);
+				free(new_entry);
+				return -ENOMEM;
+			}
 			vanc_lines->lines[i] = line;
 			vanc_lines->num_lines++;
 			break;
@@ -118,8 +285,31 @@ static int vanc_ent_comp(const void *a, const void *b)
 	return 1;
 }
 
-int klvanc_generate_vanc_line(struct klvanc_context_s *ctx, struct klvanc_line_s *line,
-			      uint16_t ** outbuf, int *out_len, int line_pixel_width)
+/* Index of the first word after the ADF that is 000-003 or 3FC-3FF, or count if
+ * there is none. Blocks are tested branch free so the compiler can vectorize them.
+ */
+static int vanc_payload_illegal(const uint16_t *payload, int count)
+{
+	int j = 3;
+
+	for (; j + 16 <= count; j += 16) {
+		int bad = 0;
+		for (int k = 0; k < 16; k++)
+			bad |= (uint16_t)(payload[j + k] - 4) >= 0x3f8;
+		if (bad)
+			break;
+	}
+	for (; j < count; j++) {
+		if (payload[j] <= 0x0003 || payload[j] >= 0x03FC)
+			break;
+	}
+
+	return j < count ? j : count;
+}
+
+/* Sort and place the entries of a line, returns the number of samples they fill */
+static int vanc_line_layout(struct klvanc_context_s *ctx, struct klvanc_line_s *line,
+			    int line_pixel_width)
 {
 	int pixels_used = 0;
 	int i;
@@ -143,20 +333,17 @@ int klvanc_generate_vanc_line(struct klvanc_context_s *ctx, struct klvanc_line_s
 		}
 
 		/* Check all bytes after VANC start words for illegal values */
-		for (int j = 3; j < entry->pixel_width; j++) {
-			if (entry->payload[j] <= 0x0003
-			    || entry->payload[j] >= 0x03FC) {
-				PRINT_DEBUG(
-					"VANC line %d has entry with illegal payload at offset %d. Skipping.  offset=%d len=%d",
-					line->line_number, j, entry->h_offset,
-					entry->pixel_width);
-				for (int k = 0; k < entry->pixel_width; k++) {
-					PRINT_DEBUG("%04x ", entry->payload[k]);
-				}
-				PRINT_DEBUG("\n");
-				entry->pixel_width = 0;
-				break;
+		int j = vanc_payload_illegal(entry->payload, entry->pixel_width);
+		if (j < entry->pixel_width) {
+			PRINT_DEBUG(
+				"VANC line %d has entry with illegal payload at offset %d. Skipping.  offset=%d len=%d",
+				line->line_number, j, entry->h_offset,
+				entry->pixel_width);
+			for (int k = 0; k < entry->pixel_width; k++) {
+				PRINT_DEBUG("%04x ", entry->payload[k]);
 			}
+			PRINT_DEBUG("\n");
+			entry->pixel_width = 0;
 		}
 
 		/* Don't let sum of all VANC entries overflow end of line */
@@ -173,6 +360,15 @@ int klvanc_generate_vanc_line(struct klvanc_context_s *ctx, struct klvanc_line_s
 		pixels_used += entry->pixel_width;
 	}
 
+	return pixels_used;
+}
+
+int klvanc_generate_vanc_line(struct klvanc_context_s *ctx, struct klvanc_line_s *line,
+			      uint16_t ** outbuf, int *out_len, int line_pixel_width)
+{
+	int pixels_used = vanc_line_layout(ctx, line, line_pixel_width);
+	int i;
+
 	/* Caller probably provided no line entries, return success as this isn't a failure of sorts. */
 	if (pixels_used == 0)
 		return 0;
@@ -193,27 +389,343 @@ int klvanc_generate_vanc_line(struct klvanc_context_s *ctx, struct klvanc_line_s
 	return 0;
 }
 
+/* Write one 10-bit sample into a v210 field, keeping the rest of the dword */
+static inline void v210_put(uint32_t *d, int shift, uint16_t v)
+{
+	*d = (*d & ~(0x3ffU << shift)) | ((uint32_t)(v & 0x3ff) << shift);
+}
+
+/* Luma at HD pixel pos onwards. Chroma, and the luma either side, are untouched. */
+static void v210_put_y(uint32_t *dst, const uint16_t *src, int pos, int count)
+{
+	static const uint8_t word[6] = { 0, 1, 1, 2, 3, 3 };
+	static const uint8_t shift[6] = { 10, 0, 20, 10, 0, 20 };
+	int i = 0;
+
+	for (; i < count && (pos + i) % 6; i++)
+		v210_put(dst + ((pos + i) / 6) * 4 + word[(pos + i) % 6], shift[(pos + i) % 6], src[i]);
+
+	int whole = ((count - i) / 6) * 6;
+	klvanc_y10_merge_v210(src + i, (uint8_t *)(dst + ((pos + i) / 6) * 4), whole);
+	i += whole;
+
+	for (; i < count; i++)
+		v210_put(dst + ((pos + i) / 6) * 4 + word[(pos + i) % 6], shift[(pos + i) % 6], src[i]);
+}
+
+/* Multiplexed SD samples at pos onwards, three to a dword */
+static void v210_put_samples(uint32_t *dst, const uint16_t *src, int pos, int count)
+{
+	int i = 0;
+
+	for (; i < count && (pos + i) % 3; i++)
+		v210_put(dst + (pos + i) / 3, ((pos + i) % 3) * 10, src[i]);
+
+	/* Whole dwords belong to the packets, so pack them straight into place */
+	int whole = ((count - i) / 12) * 12;
+	klvanc_uyvy_to_v210((uint16_t *)src + i, (uint8_t *)(dst + ((pos + i) / 3)), whole);
+	i += whole;
+
+	for (; i + 3 <= count; i += 3)
+		dst[(pos + i) / 3] = (src[i] & 0x3ff) | ((uint32_t)(src[i + 1] & 0x3ff) << 10) |
+				     ((uint32_t)(src[i + 2] & 0x3ff) << 20);
+
+	for (; i < count; i++)
+		v210_put(dst + (pos + i) / 3, ((pos + i) % 3) * 10, src[i]);
+}
+
+/* A blank v210 line alternates these, chroma 200 and luma 040 */
+#define V210_BLANK_CYC (0x200 | (0x040 << 10) | (0x200 << 20))
+#define V210_BLANK_YCY (0x040 | (0x200 << 10) | (0x040 << 20))
+
+/* Dwords klvanc_y10_to_v210() or klvanc_uyvy_to_v210() write for count samples */
+static int span_dwords(int count, int hd)
+{
+	static const uint8_t tail[6] = { 0, 1, 2, 2, 3, 4 };
+
+	if (hd)
+		return ((count / 6) * 4) + tail[count % 6];
+	return (count + 2) / 3;
+}
+
+/* Render a line as klvanc_y10_to_v210() or klvanc_uyvy_to_v210() would pack it, so the dwords
+ * the packets span get blanking wherever a packet doesn't land. Returns the samples used.
+ */
+static int line_render_span(struct klvanc_context_s *ctx, struct klvanc_line_s *line,
+			    uint32_t *dst, int line_pixel_width)
+{
+	int hd = line_pixel_width > 720;
+	int count = vanc_line_layout(ctx, line, line_pixel_width);
+	int dwords = span_dwords(count, hd);
+
+	for (int i = 0; i < dwords; i++)
+		dst[i] = (i & 1) ? V210_BLANK_YCY : V210_BLANK_CYC;
+
+	for (int i = 0; i < line->num_entries; i++) {
+		struct klvanc_entry_s *entry = line->p_entries[i];
+		if (entry->pixel_width == 0)
+			continue;
+		if (hd)
+			v210_put_y(dst, entry->payload, entry->h_offset, entry->pixel_width);
+		else
+			v210_put_samples(dst, entry->payload, entry->h_offset, entry->pixel_width);
+	}
+
+	return count;
+}
+
+/* The last rendering of a line number, see klvanc_context_enable_render_cache() */
+struct vanc_render_line_s
+{
+	uint64_t fingerprint;
+	int width;
+	int count;		/* Samples the packets span */
+	int dwords;		/* Of v210 they were packed into */
+	int alloc;		/* Dwords v210 can hold */
+	uint32_t *v210;
+};
+
+/* Everything rendering depends on, the entries as inserted and the line width */
+static uint64_t line_fingerprint(const struct klvanc_line_s *line, int line_pixel_width)
+{
+	uint64_t h = ((uint64_t)line_pixel_width << 32) | line->num_entries;
+
+	for (int i = 0; i < line->num_entries; i++) {
+		const struct klvanc_entry_s *entry = line->p_entries[i];
+		uint64_t placement = ((uint64_t)entry->h_offset << 32) | (uint32_t)entry->pixel_width;
+		h = klvanc_hash64(entry->payload, entry->pixel_width * sizeof(uint16_t), h ^ placement);
+	}
+
+	return h;
+}
+
+/* The cached rendering of a line, brought up to date if its entries changed. NULL when the
+ * cache is off, or can't hold the line. Lines have an entry each, so workers don't collide.
+ */
+static struct vanc_render_line_s *line_render_cached(struct klvanc_context_s *ctx, struct klvanc_line_s *line,
+						     int line_pixel_width, int *reused)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+
+	if (!priv->render || line->line_number < 0 || line->line_number >= KLVANC_SUBSCRIBE_MAX_LINES)
+		return NULL;
+
+	uint64_t fingerprint = line_fingerprint(line, line_pixel_width);
+	struct vanc_render_line_s *r = priv->render[line->line_number];
+	if (r && r->fingerprint == fingerprint && r->width == line_pixel_width) {
+		*reused = 1;
+		return r;
+	}
+
+	int alloc = ((line_pixel_width + 5) / 6) * 4;
+	if (!r) {
+		r = calloc(1, sizeof(*r));
+		if (!r)
+			return NULL;
+		priv->render[line->line_number] = r;
+	}
+	if (r->alloc < alloc) {
+		uint32_t *p = realloc(r->v210, alloc * sizeof(uint32_t));
+		if (!p)
+			return NULL;
+		r->v210 = p;
+		r->alloc = alloc;
+	}
+
+	/* Placement is decided by the entries as inserted, fingerprint them before layout moves them */
+	r->count = line_render_span(ctx, line, r->v210, line_pixel_width);
+	r->dwords = span_dwords(r->count, line_pixel_width > 720);
+	r->fingerprint = fingerprint;
+	r->width = line_pixel_width;
+	*reused = 0;
+
+	return r;
+}
+
+/* Copy only the packet samples of a cached rendering into a frame row */
+static void line_apply_cached(const struct vanc_render_line_s *r, uint32_t *dst)
+{
+	static const uint8_t word[6] = { 0, 1, 1, 2, 3, 3 };
+	static const uint8_t shift[6] = { 10, 0, 20, 10, 0, 20 };
+	const uint32_t *src = r->v210;
+
+	if (r->width > 720) {
+		/* Both halves of a group have chroma in the same fields, so it merges 64 bits at a time */
+		const uint64_t chroma = 0x000ffc003ff003ffULL;
+		int groups = r->count / 6;
+		uint64_t *d64 = (uint64_t *)dst;
+		const uint64_t *s64 = (const uint64_t *)src;
+		for (int i = 0; i < groups * 2; i++)
+			d64[i] = (d64[i] & chroma) | (s64[i] & ~chroma);
+		for (int k = 0; k < r->count % 6; k++) {
+			int d = (groups * 4) + word[k];
+			v210_put(dst + d, shift[k], (src[d] >> shift[k]) & 0x3ff);
+		}
+	} else {
+		int full = r->count / 3;
+		memcpy(dst, src, full * sizeof(uint32_t));
+		for (int k = 0; k < r->count % 3; k++)
+			v210_put(dst + full, k * 10, (src[full] >> (k * 10)) & 0x3ff);
+	}
+}
+
 int klvanc_generate_vanc_line_v210(struct klvanc_context_s *ctx,
                                    struct klvanc_line_s *line,
                                    uint8_t *out_buf, int line_pixel_width)
 {
-	uint16_t *out_line;
-	int out_len;
-	int result;
+	int reused;
 
-	/* Generate the full line taking into account all VANC packets on that line */
-	result = klvanc_generate_vanc_line(ctx, line, &out_line, &out_len,
-					   line_pixel_width);
-	if (result != 0) {
+	/* Packed straight into out_buf, as the 16-bit line klvanc_generate_vanc_line() builds would be */
+	struct vanc_render_line_s *r = line_render_cached(ctx, line, line_pixel_width, &reused);
+	if (r)
+		memcpy(out_buf, r->v210, r->dwords * sizeof(uint32_t));
+	else
+		line_render_span(ctx, line, (uint32_t *)out_buf, line_pixel_width);
+
+	return 0;
+}
+
+/* Render a line's packets into its row of a v210 frame, the row is dst. Returns 1 when
+ * the line came from the render cache.
+ */
+static int line_render_v210(struct klvanc_context_s *ctx, struct klvanc_line_s *line,
+			    uint32_t *dst, int line_pixel_width)
+{
+	int reused;
+
+	struct vanc_render_line_s *r = line_render_cached(ctx, line, line_pixel_width, &reused);
+	if (r) {
+		line_apply_cached(r, dst);
+		return reused;
+	}
+
+	vanc_line_layout(ctx, line, line_pixel_width);
+
+	/* Packets go straight from their entries into place, HD into the luma stream only */
+	for (int i = 0; i < line->num_entries; i++) {
+		struct klvanc_entry_s *entry = line->p_entries[i];
+		if (entry->pixel_width == 0)
+			continue;
+		if (line_pixel_width > 720)
+			v210_put_y(dst, entry->payload, entry->h_offset, entry->pixel_width);
+		else
+			v210_put_samples(dst, entry->payload, entry->h_offset, entry->pixel_width);
+	}
+
+	return 0;
+}
+
+int klvanc_context_enable_render_cache(struct klvanc_context_s *ctx)
+{
+	VALIDATE(ctx);
+
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	if (priv->render)
+		return KLAPI_OK;
+
+	priv->render = calloc(KLVANC_SUBSCRIBE_MAX_LINES, sizeof(struct vanc_render_line_s *));
+	if (!priv->render)
 		return -ENOMEM;
+
+	return KLAPI_OK;
+}
+
+void klvanc_render_cache_free(struct klvanc_context_s *ctx)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+
+	if (!priv->render)
+		return;
+
+	for (int i = 0; i < KLVANC_SUBSCRIBE_MAX_LINES; i++) {
+		if (priv->render[i]) {
+			free(priv->render[i]->v210);
+			free(priv->render[i]);
+		}
 	}
+	free(priv->render);
+	priv->render = NULL;
+}
 
-	/* Repack the 16-bit ints into 10-bit, and push into final buffer */
-	if (line_pixel_width > 720)
-		klvanc_y10_to_v210(out_line, out_buf, out_len);
-	else
-		klvanc_uyvy_to_v210(out_line, out_buf, out_len);
+static int line_in_frame(const struct klvanc_line_s *line, unsigned int first_line, unsigned int line_count)
+{
+	return line->line_number >= 0 && (unsigned int)line->line_number >= first_line &&
+	       (unsigned int)line->line_number - first_line < line_count;
+}
+
+int klvanc_generate_vanc_line_v210_frame(struct klvanc_context_s *ctx, struct klvanc_line_s *line,
+					 uint8_t *frame, int stride, unsigned int first_line,
+					 unsigned int line_count, int line_pixel_width)
+{
+	VALIDATE(ctx);
+	VALIDATE(line);
+	VALIDATE(frame);
+
+	if (line_pixel_width <= 0 || stride < ((line_pixel_width + 5) / 6) * 16)
+		return -EINVAL;
+	if (!line_in_frame(line, first_line, line_count))
+		return -EINVAL;
+
+	line_render_v210(ctx, line,
+			 (uint32_t *)(frame + ((size_t)(line->line_number - first_line) * stride)),
+			 line_pixel_width);
 
-	free(out_line);
 	return 0;
 }
+
+/* A frame being rendered by the klvanc_context_enable_threads() workers, one line each */
+struct frame_render_s
+{
+	struct klvanc_context_s *ctx;
+	struct klvanc_line_set_s *set;
+	uint8_t *frame;
+	int stride;
+	int width;
+	unsigned int firstLine;
+	unsigned int lineCount;
+	int reused;
+};
+
+static void frame_render_line(void *arg, unsigned int n)
+{
+	struct frame_render_s *r = arg;
+	struct klvanc_line_s *line = r->set->lines[n];
+
+	if (!line_in_frame(line, r->firstLine, r->lineCount))
+		return;
+
+	if (line_render_v210(r->ctx, line,
+			     (uint32_t *)(r->frame + ((size_t)(line->line_number - r->firstLine) * r->stride)),
+			     r->width))
+		__atomic_fetch_add(&r->reused, 1, __ATOMIC_RELAXED);
+}
+
+int klvanc_generate_vanc_frame_v210(struct klvanc_context_s *ctx, struct klvanc_line_set_s *set,
+				    uint8_t *frame, int stride, int width,
+				    unsigned int first_line, unsigned int line_count)
+{
+	VALIDATE(ctx);
+	VALIDATE(set);
+	VALIDATE(frame);
+
+	if (width <= 0 || stride < ((width + 5) / 6) * 16)
+		return -EINVAL;
+
+	uint64_t begin = klvanc_stats_begin(ctx);
+	struct frame_render_s r = { ctx, set, frame, stride, width, first_line, line_count, 0 };
+	int lines = 0;
+
+	for (int i = 0; i < set->num_lines; i++)
+		lines += line_in_frame(set->lines[i], first_line, line_count);
+
+	/* Lines are independent, each worker owns its row and its line's entries */
+	if (lines < 2 || klvanc_frame_pool_for(ctx, set->num_lines, frame_render_line, &r) < 0) {
+		for (int i = 0; i < set->num_lines; i++)
+			frame_render_line(&r, i);
+	}
+
+	if (begin)
+		klvanc_stats_generate(ctx, begin, lines, r.reused);
+
+	return lines;
+}
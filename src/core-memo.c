@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2026 Kernel Labs Inc. All Rights Reserved
+ *
+ * Address: Kernel Labs Inc., PO Box 745, St James, NY. 11780
+ * Contact: sales@kernellabs.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Memoized decode, see klvanc_context_enable_memo(). Every packet position, a
+ * line and horizontal offset, remembers a hash of the words last seen there and
+ * the struct they decoded to. A packet hashing the same as its predecessor isn't
+ * decoded again, the remembered struct is delivered in its place.
+ */
+
+#include <libklvanc/vanc.h>
+
+#include "core-private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct vanc_memo_entry_s
+{
+	uint32_t key;		/* lineNr << 16 | horizontalOffset, plus one so zero means unused */
+	uint16_t did;
+	uint16_t sdid;
+	unsigned int words;
+	uint64_t hash;
+
+	/* The decoded struct and how to let go of it, NULL until a decode succeeds */
+	void *decoded;
+	int (*parse)(struct klvanc_context_s *, struct klvanc_packet_header_s *, void **);
+	enum klvanc_packet_type_e type;
+	void (*release)(struct klvanc_context_s *, enum klvanc_packet_type_e, void *);
+	void (*free)(void *);
+};
+
+struct vanc_memo_s
+{
+	struct vanc_memo_entry_s *entries;
+	unsigned int size;	/* Power of two */
+	unsigned int count;
+};
+
+/* XXH64, four independent lanes over 32 byte stripes */
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const uint8_t *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t read32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t input)
+{
+	acc += input * PRIME64_2;
+	acc = rotl64(acc, 31);
+	return acc * PRIME64_1;
+}
+
+static inline uint64_t hash_merge(uint64_t acc, uint64_t val)
+{
+	acc ^= hash_round(0, val);
+	return (acc * PRIME64_1) + PRIME64_4;
+}
+
+uint64_t klvanc_hash64(const void *data, size_t len, uint64_t seed)
+{
+	const uint8_t *p = data;
+	const uint8_t *end = p + len;
+	uint64_t h;
+
+	if (len >= 32) {
+		uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+		uint64_t v2 = seed + PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME64_1;
+
+		for (; p + 32 <= end; p += 32) {
+			v1 = hash_round(v1, read64(p));
+			v2 = hash_round(v2, read64(p + 8));
+			v3 = hash_round(v3, read64(p + 16));
+			v4 = hash_round(v4, read64(p + 24));
+		}
+
+		h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+		h = hash_merge(h, v1);
+		h = hash_merge(h, v2);
+		h = hash_merge(h, v3);
+		h = hash_merge(h, v4);
+	} else
+		h = seed + PRIME64_5;
+
+	h += len;
+
+	for (; p + 8 <= end; p += 8) {
+		h ^= hash_round(0, read64(p));
+		h = (rotl64(h, 27) * PRIME64_1) + PRIME64_4;
+	}
+	if (p + 4 <= end) {
+		h ^= read32(p) * PRIME64_1;
+		h = (rotl64(h, 23) * PRIME64_2) + PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		h ^= *p * PRIME64_5;
+		h = rotl64(h, 11) * PRIME64_1;
+	}
+
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+static void memo_release(struct klvanc_context_s *ctx, struct vanc_memo_entry_s *e)
+{
+	if (e->decoded && e->release)
+		e->release(ctx, e->type, e->decoded);
+	else if (e->decoded && e->free)
+		e->free(e->decoded);
+	e->decoded = NULL;
+}
+
+static struct vanc_memo_entry_s *memo_probe(struct vanc_memo_s *memo, uint32_t key)
+{
+	unsigned int mask = memo->size - 1;
+	unsigned int i = (unsigned int)((key * PRIME64_1) >> 32) & mask;
+
+	while (memo->entries[i].key && memo->entries[i].key != key)
+		i = (i + 1) & mask;
+
+	return &memo->entries[i];
+}
+
+/* Keep the table at most half full, so probes stay short */
+static int memo_grow(struct klvanc_context_s *ctx, struct vanc_memo_s *memo)
+{
+	struct vanc_memo_s grown = { NULL, memo->size ? memo->size * 2 : 64, memo->count };
+
+	grown.entries = calloc(grown.size, sizeof(struct vanc_memo_entry_s));
+	if (!grown.entries)
+		return -ENOMEM;
+	getPrivate(ctx)->stats.allocations++;
+
+	for (unsigned int i = 0; i < memo->size; i++) {
+		if (memo->entries[i].key)
+			*memo_probe(&grown, memo->entries[i].key) = memo->entries[i];
+	}
+
+	free(memo->entries);
+	*memo = grown;
+
+	return KLAPI_OK;
+}
+
+/* Deliver a decoded struct again, as its decoder would have */
+static void memo_redeliver(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr,
+			   const struct vanc_decoder_s *dec, struct vanc_memo_entry_s *e)
+{
+	struct klvanc_callbacks_s *cb = ctx->callbacks;
+
+	/* Application decoders get their callback from us, with their own struct */
+	if (!e->release) {
+		if (dec && dec->cb)
+			KLVANC_CALLBACK(ctx, dec->cb(ctx->callback_context, ctx, hdr, e->decoded));
+		return;
+	}
+
+	/* Builtin structs all lead with a copy of the header, whose payload and raw
+	 * pointers have to follow the packet into this frame's words.
+	 */
+	memcpy(e->decoded, hdr, sizeof(*hdr));
+
+	if (!cb)
+		return;
+
+	switch (e->type) {
+	case VANC_TYPE_AFD:
+		if (cb->afd)
+			KLVANC_CALLBACK(ctx, cb->afd(ctx->callback_context, ctx, e->decoded));
+		break;
+	case VANC_TYPE_EIA_708B:
+		if (cb->eia_708b)
+			KLVANC_CALLBACK(ctx, cb->eia_708b(ctx->callback_context, ctx, e->decoded));
+		break;
+	case VANC_TYPE_EIA_608:
+		if (cb->eia_608)
+			KLVANC_CALLBACK(ctx, cb->eia_608(ctx->callback_context, ctx, e->decoded));
+		break;
+	case VANC_TYPE_KL_UINT64_COUNTER:
+		if (cb->kl_i64le_counter)
+			KLVANC_CALLBACK(ctx, cb->kl_i64le_counter(ctx->callback_context, ctx, e->decoded));
+		break;
+	case VANC_TYPE_SDP:
+		if (cb->sdp)
+			KLVANC_CALLBACK(ctx, cb->sdp(ctx->callback_context, ctx, e->decoded));
+		break;
+	case VANC_TYPE_SMPTE_S12_2:
+		if (cb->smpte_12_2)
+			KLVANC_CALLBACK(ctx, cb->smpte_12_2(ctx->callback_context, ctx, e->decoded));
+		break;
+	case VANC_TYPE_SMPTE_S2108_1:
+		if (cb->smpte_2108_1)
+			KLVANC_CALLBACK(ctx, cb->smpte_2108_1(ctx->callback_context, ctx, e->decoded));
+		break;
+	default:
+		break;
+	}
+}
+
+int klvanc_memo_deliver(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr,
+			const struct vanc_decoder_s *dec, struct vanc_memo_entry_s **entry)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	struct vanc_memo_s *memo = priv->memo;
+
+	*entry = NULL;
+
+	/* SCTE-104 reassembles messages across packets, every one of them matters */
+	if (hdr->type == VANC_TYPE_SCTE_104 || hdr->lineNr >= 0xffff)
+		return 0;
+
+	if ((memo->count + 1) * 2 > memo->size && memo_grow(ctx, memo) < 0)
+		return 0;
+
+	uint32_t key = ((hdr->lineNr << 16) | hdr->horizontalOffset) + 1;
+	uint64_t hash = klvanc_hash64(hdr->raw, hdr->rawLengthWords * sizeof(uint16_t), 0);
+	struct vanc_memo_entry_s *e = memo_probe(memo, key);
+
+	if (!e->key) {
+		e->key = key;
+		memo->count++;
+	} else if (e->hash == hash && e->words == hdr->rawLengthWords &&
+		   e->did == hdr->did && e->sdid == hdr->dbnsdid &&
+		   (dec ? e->decoded && e->parse == dec->parse : !e->decoded)) {
+		struct klvanc_callbacks_s *cb = ctx->callbacks;
+
+		if (cb && cb->unchanged)
+			KLVANC_CALLBACK(ctx, cb->unchanged(ctx->callback_context, ctx, hdr));
+		else {
+			if (cb && cb->all)
+				KLVANC_CALLBACK(ctx, cb->all(ctx->callback_context, ctx, hdr));
+			if (e->decoded)
+				memo_redeliver(ctx, hdr, dec, e);
+		}
+
+		if (priv->frameCollect)
+			klvanc_frame_collect(ctx, hdr);
+		if (priv->stats.enabled)
+			priv->stats.packetsUnchanged++;
+
+		return 1;
+	}
+
+	/* Something new at this position, forget whatever was here */
+	memo_release(ctx, e);
+	e->did = hdr->did;
+	e->sdid = hdr->dbnsdid;
+	e->words = hdr->rawLengthWords;
+	e->hash = hash;
+	*entry = e;
+
+	return 0;
+}
+
+void klvanc_memo_store(struct vanc_memo_entry_s *e, const struct vanc_decoder_s *dec, void *decoded)
+{
+	e->decoded = decoded;
+	e->parse = dec ? dec->parse : NULL;
+	e->type = dec ? dec->type : VANC_TYPE_UNDEFINED;
+	e->release = dec ? dec->release : NULL;
+	e->free = dec ? dec->free : NULL;
+}
+
+void klvanc_memo_free(struct klvanc_context_s *ctx)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	struct vanc_memo_s *memo = priv->memo;
+
+	if (!memo)
+		return;
+
+	for (unsigned int i = 0; i < memo->size; i++)
+		memo_release(ctx, &memo->entries[i]);
+	free(memo->entries);
+	free(memo);
+	priv->memo = NULL;
+}
+
+int klvanc_context_enable_memo(struct klvanc_context_s *ctx)
+{
+	VALIDATE(ctx);
+
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	if (priv->memo)
+		return KLAPI_OK;
+
+	priv->memo = calloc(1, sizeof(struct vanc_memo_s));
+	if (!priv->memo)
+		return -ENOMEM;
+
+	if (memo_grow(ctx, priv->memo) < 0) {
+		free(priv->memo);
+		priv->memo = NULL;
+		return -ENOMEM;
+	}
+
+	return KLAPI_OK;
+}
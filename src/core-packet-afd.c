@@ -131,10 +131,14 @@ int parse_AFD(struct klvanc_context_s *ctx,
 	if (ctx->callbacks == NULL || ctx->callbacks->afd == NULL)
 		return KLAPI_OK;
 
+	/* The payload is a view into the caller's line, don't read beyond the packet */
+	if (hdr->payloadLengthWords < 8)
+		return -EINVAL;
+
 	if (ctx->verbose)
 		PRINT_DEBUG("%s()\n", __func__);
 
-	struct klvanc_packet_afd_s *pkt = calloc(1, sizeof(*pkt));
+	struct klvanc_packet_afd_s *pkt = klvanc_pool_get(ctx, VANC_TYPE_AFD, sizeof(*pkt));
 	if (!pkt)
 		return -ENOMEM;
 
@@ -161,7 +165,7 @@ int parse_AFD(struct klvanc_context_s *ctx,
 		pkt->right |= sanitizeWord(hdr->payload[7]);
 	}
 
-	ctx->callbacks->afd(ctx->callback_context, ctx, pkt);
+	KLVANC_CALLBACK(ctx, ctx->callbacks->afd(ctx->callback_context, ctx, pkt));
 
 	*pp = pkt;
 	return KLAPI_OK;
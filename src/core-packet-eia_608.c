@@ -53,10 +53,14 @@ int parse_EIA_608(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *h
 	if (ctx->callbacks == NULL || ctx->callbacks->eia_608 == NULL)
 		return KLAPI_OK;
 
+	/* The payload is a view into the caller's line, don't read beyond the packet */
+	if (hdr->payloadLengthWords < 3)
+		return -EINVAL;
+
 	if (ctx->verbose)
 		PRINT_DEBUG("%s()\n", __func__);
 
-	struct klvanc_packet_eia_608_s *pkt = calloc(1, sizeof(*pkt));
+	struct klvanc_packet_eia_608_s *pkt = klvanc_pool_get(ctx, VANC_TYPE_EIA_608, sizeof(*pkt));
 	if (!pkt)
 		return -ENOMEM;
 
@@ -76,7 +80,7 @@ int parse_EIA_608(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *h
 	pkt->cc_data_1 = pkt->payload[1];
 	pkt->cc_data_2 = pkt->payload[2];
 
-	ctx->callbacks->eia_608(ctx->callback_context, ctx, pkt);
+	KLVANC_CALLBACK(ctx, ctx->callbacks->eia_608(ctx->callback_context, ctx, pkt));
 
 	*pp = pkt;
 	return KLAPI_OK;
@@ -222,28 +222,22 @@ int klvanc_dump_EIA_708B(struct klvanc_context_s *ctx, void *p)
 
 int parse_EIA_708B(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr, void **pp)
 {
-	struct klbs_context_s *bs;
+	struct klbs_context_s bitstream, *bs = &bitstream;
 	uint8_t next_section_id;
 
 	if (ctx->callbacks == NULL || ctx->callbacks->eia_708b == NULL)
 		return KLAPI_OK;
 
-	bs = klbs_alloc();
-	if (bs == NULL)
-		return -ENOMEM;
-
 	if (ctx->verbose)
 		PRINT_DEBUG("%s()\n", __func__);
 
-	struct klvanc_packet_eia_708b_s *pkt = calloc(1, sizeof(*pkt));
-	if (!pkt) {
-		klbs_free(bs);
+	struct klvanc_packet_eia_708b_s *pkt = klvanc_pool_get(ctx, VANC_TYPE_EIA_708B, sizeof(*pkt));
+	if (!pkt)
 		return -ENOMEM;
-	}
 
 	memcpy(&pkt->hdr, hdr, sizeof(*hdr));
 	/* Extract the 8-bit bitstream from the 10-bit payload */
-	for (int i = 0; i < 256; i++)
+	for (int i = 0; i < hdr->payloadLengthWords && i < sizeof(pkt->payload); i++)
 		pkt->payload[i] = hdr->payload[i];
 	pkt->payloadLengthBytes = hdr->payloadLengthWords;
 
@@ -252,8 +246,7 @@ int parse_EIA_708B(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *
 
 	/* CDP Header (Sec 11.2.2) */
 	if (klbs_get_byte_count_free(bs) < 7) {
-		free(pkt);
-		klbs_free(bs);
+		klvanc_pool_put(ctx, VANC_TYPE_EIA_708B, pkt);
 		return -ENOMEM;
 	}
 	pkt->header.cdp_identifier = klbs_read_bits(bs, 16);
@@ -271,16 +264,14 @@ int parse_EIA_708B(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *
 	pkt->header.cdp_hdr_sequence_cntr = klbs_read_bits(bs, 16);
 
 	if (klbs_get_byte_count_free(bs) < 1) {
-		free(pkt);
-		klbs_free(bs);
+		klvanc_pool_put(ctx, VANC_TYPE_EIA_708B, pkt);
 		return -ENOMEM;
 	}
 	next_section_id = klbs_read_bits(bs, 8);
 
 	if (next_section_id == 0x71) {
 		if (klbs_get_byte_count_free(bs) < 5) {
-			free(pkt);
-			klbs_free(bs);
+			klvanc_pool_put(ctx, VANC_TYPE_EIA_708B, pkt);
 			return -ENOMEM;
 		}
 		/* timecode_section (Sec 11.2.3) */
@@ -305,8 +296,7 @@ int parse_EIA_708B(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *
 
 	if (next_section_id == 0x72) {
 		if (klbs_get_byte_count_free(bs) < 2) {
-			free(pkt);
-			klbs_free(bs);
+			klvanc_pool_put(ctx, VANC_TYPE_EIA_708B, pkt);
 			return -ENOMEM;
 		}
 		/* cc_data_section (Sec 11.2.4) */
@@ -315,8 +305,7 @@ int parse_EIA_708B(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *
 		pkt->ccdata.cc_count = klbs_read_bits(bs, 5);
 
 		if (klbs_get_byte_count_free(bs) < (pkt->ccdata.cc_count * 3)) {
-			free(pkt);
-			klbs_free(bs);
+			klvanc_pool_put(ctx, VANC_TYPE_EIA_708B, pkt);
 			return -ENOMEM;
 		}
 		for (int i = 0; i < pkt->ccdata.cc_count; i++) {
@@ -331,8 +320,7 @@ int parse_EIA_708B(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *
 
 	if (next_section_id == 0x73) {
 		if (klbs_get_byte_count_free(bs) < 3) {
-			free(pkt);
-			klbs_free(bs);
+			klvanc_pool_put(ctx, VANC_TYPE_EIA_708B, pkt);
 			return -ENOMEM;
 		}
 		/* ccsvcinfo_section (Sec 11.2.5) */
@@ -345,8 +333,7 @@ int parse_EIA_708B(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *
 
 		/* Abort the parse if we don't have enough data in the bitstream. */
 		if (klbs_get_byte_count_free(bs) < pkt->ccsvc.svc_count * 7) {
-			free(pkt);
-			klbs_free(bs);
+			klvanc_pool_put(ctx, VANC_TYPE_EIA_708B, pkt);
 			return -ENOMEM;
 		}
 
@@ -379,8 +366,7 @@ int parse_EIA_708B(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *
 	if (next_section_id == 0x74) {
 		/* cdp_footer section (Sec 11.2.6) */
 		if (klbs_get_byte_count_free(bs) < 3) {
-			free(pkt);
-			klbs_free(bs);
+			klvanc_pool_put(ctx, VANC_TYPE_EIA_708B, pkt);
 			return -ENOMEM;
 		}
 		pkt->footer.cdp_footer_id = next_section_id;
@@ -398,9 +384,7 @@ int parse_EIA_708B(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *
 	else
 		pkt->checksum_valid = 0;
 
-	ctx->callbacks->eia_708b(ctx->callback_context, ctx, pkt);
-
-	klbs_free(bs);
+	KLVANC_CALLBACK(ctx, ctx->callbacks->eia_708b(ctx->callback_context, ctx, pkt));
 
 	*pp = pkt;
 	return KLAPI_OK;
@@ -55,10 +55,14 @@ int parse_KL_U64LE_COUNTER(struct klvanc_context_s *ctx, struct klvanc_packet_he
 	if (ctx->callbacks == NULL || ctx->callbacks->kl_i64le_counter == NULL)
 		return KLAPI_OK;
 
+	/* The payload is a view into the caller's line, don't read beyond the packet */
+	if (hdr->payloadLengthWords < 8)
+		return -EINVAL;
+
 	if (ctx->verbose)
 		PRINT_DEBUG("%s()\n", __func__);
 
-	struct klvanc_packet_kl_u64le_counter_s *pkt = calloc(1, sizeof(*pkt));
+	struct klvanc_packet_kl_u64le_counter_s *pkt = klvanc_pool_get(ctx, VANC_TYPE_KL_UINT64_COUNTER, sizeof(*pkt));
 	if (!pkt)
 		return -ENOMEM;
 
@@ -74,7 +78,7 @@ int parse_KL_U64LE_COUNTER(struct klvanc_context_s *ctx, struct klvanc_packet_he
 	pkt->counter |= (uint64_t)sanitizeWord(hdr->payload[6]) <<  8;
 	pkt->counter |= (uint64_t)sanitizeWord(hdr->payload[7]);
 
-	ctx->callbacks->kl_i64le_counter(ctx->callback_context, ctx, pkt);
+	KLVANC_CALLBACK(ctx, ctx->callbacks->kl_i64le_counter(ctx->callback_context, ctx, pkt));
 
 	*pp = pkt;
 	return KLAPI_OK;
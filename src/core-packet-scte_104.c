@@ -909,23 +909,39 @@ int klvanc_dump_SCTE_104(struct klvanc_context_s *ctx, void *p)
 	return dump_mom(ctx, pkt);
 }
 
-void klvanc_free_SCTE_104(void *p)
+static void free_ops(struct klvanc_packet_scte_104_s *pkt)
 {
-	struct klvanc_packet_scte_104_s *pkt = p;
-	struct klvanc_multiple_operation_message *m;
-
-	if (pkt == NULL)
-		return;
+	struct klvanc_multiple_operation_message *m = &pkt->mo_msg;
 
-	m = &pkt->mo_msg;
 	for (int i = 0; i < m->num_ops; i++) {
 		free(m->ops[i].data);
 	}
 	free(m->ops);
+}
+
+void klvanc_free_SCTE_104(void *p)
+{
+	struct klvanc_packet_scte_104_s *pkt = p;
+
+	if (pkt == NULL)
+		return;
 
+	free_ops(pkt);
 	free(pkt);
 }
 
+/* Decoded packets come from the context pool, see parse_SCTE_104() */
+void release_SCTE_104(struct klvanc_context_s *ctx, enum klvanc_packet_type_e type, void *p)
+{
+	struct klvanc_packet_scte_104_s *pkt = p;
+
+	if (pkt == NULL)
+		return;
+
+	free_ops(pkt);
+	klvanc_pool_put(ctx, type, pkt);
+}
+
 /* TODO: If we find another VANC case where packets are fragmented, lift this code
  * into the core and adjust function naming, share/re-use.
  */
@@ -1025,25 +1041,23 @@ static int messageFragmentFinal(struct klvanc_context_s *ctx, struct klvanc_pack
 	 * Clone the fragment final packet, which is mostly correctl, update its headers and paylaod 
 	 * to incoude al the fragments.
 	 */
+	unsigned int words = 0;
+	for (int i = 0; i < ctx->scte104_fragment_count; i++)
+		words += ctx->scte104_fragments[i]->rawLengthWords;
+
+	/* Large enough to hold the raw words of every fragment, the payload is always smaller.
+	 * Payload and raw lengths start at zero and grow as each fragment is appended.
+	 */
 	struct klvanc_packet_header_s *dst;
-	if (klvanc_packet_copy(&dst, hdr) < 0) {
+	if (klvanc_packet_alloc(&dst, hdr, words) < 0) {
 		messageFragmentReset(ctx);
 		return -1;
 	}
 
-	/* These two packet header fields will need to be adjusted.
-	 * unsigned short		payload[16384];
-	 * unsigned short		payloadLengthWords;
-	 * The following two fields shouldn't be referenced during parsing, I'm ignoring them.
-	 * unsigned short		raw[16384];
-	 * unsigned int 		rawLengthWords;
-	 */
-
 	dst->checksumValid = 0;
-	dst->payloadLengthWords = 0;
-	dst->rawLengthWords = 0;
-	memset(dst->raw, 0, sizeof(dst->raw));
-	memset(dst->payload, 0, sizeof(dst->payload));
+	dst->parityValid = 1;
+	for (int i = 0; i < ctx->scte104_fragment_count; i++)
+		dst->parityValid &= ctx->scte104_fragments[i]->parityValid;
 
 	for (int i = 0; i < ctx->scte104_fragment_count; i++) {
 		int offset = 0; 
@@ -1078,7 +1092,7 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 	if (ctx->verbose)
 		PRINT_DEBUG("%s()\n", __func__);
 
-	struct klvanc_packet_scte_104_s *pkt = calloc(1, sizeof(*pkt));
+	struct klvanc_packet_scte_104_s *pkt = klvanc_pool_get(ctx, VANC_TYPE_SCTE_104, sizeof(*pkt));
 	if (!pkt)
 		return -ENOMEM;
 
@@ -1093,7 +1107,7 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 
 	if (pkt->duplicate_msg) {
 		printf("%s() pkt->duplicate_msg is unsupported, parse aborted.\n", __func__);
-		free(pkt);
+		klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 		return -1;
 	}
 
@@ -1110,20 +1124,20 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 			 */
 			messageFragmentReset(ctx);
 			messageFragmentContinued(ctx, hdr);
-			free(pkt);
+			klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 			return -1; /* Signal upper layers we're not happy. In reality we're collecting. */
 		} else
 		if (pkt->continued_pkt && pkt->following_pkt) {
 			/* Intermediate packet */
 			messageFragmentFollowing(ctx, hdr);
-			free(pkt);
+			klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 			return -1; /* Signal upper layers we're not happy. In reality we're collecting. */
 		} else
 		if (pkt->continued_pkt == 0 && pkt->following_pkt) {
 			/* Final packet */
 			if (messageFragmentFinal(ctx, hdr, &fullhdr) < 0) {
 				printf("%s() unable to assemble fragments, skipping.\n", __func__);
-				free(pkt);
+				klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 				return -1;
 			}
 			/* Use the complete defragged header, not the final fragment header
@@ -1134,7 +1148,7 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 
 		} else {
 			printf("%s() pkt->payloadDescriptorByte != 0x08 (0x%x)\n", __func__, pkt->payloadDescriptorByte);
-			free(pkt);
+			klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 			return -1;
 		}
 	} else {
@@ -1162,8 +1176,15 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 	 * ST: Subsequently extended this to support much larger messages, up to 2000
 	 *     as ser ST2010-2008 Section 5.
 	 */
-	for (int i = 0; i < sizeof(pkt->payload); i++) {
-		/* hdr->payload is defined as 16384 shorts */
+	if (hdr->payloadLengthWords == 0 || hdr->payloadLengthWords - 1 > sizeof(pkt->payload)) {
+		PRINT_ERR("%s() SCTE104 payload length %d is invalid, parse aborted.\n", __func__,
+			  hdr->payloadLengthWords);
+		if (fullhdr)
+			klvanc_packet_free(fullhdr);
+		klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
+		return -1;
+	}
+	for (int i = 0; i < hdr->payloadLengthWords - 1; i++) {
 		pkt->payload[i] = hdr->payload[1 + i];
 	}
 	pkt->payloadLengthBytes = hdr->payloadLengthWords - 1;
@@ -1212,7 +1233,7 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 		default:
 			/* We don't support this splice command */
 			PRINT_ERR("%s() splice_insert_type 0x%x, error.\n", __func__, d->splice_insert_type);
-			free(pkt);
+			klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 			return -1;
 		}
 	} else
@@ -1220,7 +1241,7 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 	if (m->opID == 0xFFFF /* Multiple Operation Message */) {
 		if (pkt->payloadLengthBytes < 10) {
 			PRINT_ERR("%s() packet too short size=%d\n", __func__, pkt->payloadLengthBytes);
-			free(pkt);
+			klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 			return -1;
 		}
 
@@ -1234,7 +1255,7 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 
 		if (mom->messageSize > pkt->payloadLengthBytes) {
 			PRINT_ERR("%s() MOM packet too short MOM=%d pkt=%d\n", __func__, mom->messageSize, pkt->payloadLengthBytes);
-			free(pkt);
+			klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 			return -1;
 		}
 
@@ -1245,7 +1266,7 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 		mom->ops = calloc(mom->num_ops, sizeof(struct klvanc_multiple_operation_message_operation));
 		if (!mom->ops) {
 			PRINT_ERR("%s() unable to allocate momo ram, error.\n", __func__);
-			free(pkt);
+			klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 			return -1;
 		}
 
@@ -1259,7 +1280,7 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 				for (int j = 0; j < i; j++)
 					free(mom->ops[j].data);
 				free(mom->ops);
-				free(pkt);
+				klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 				return -1;
 			}
 			o->data = malloc(o->data_length);
@@ -1268,7 +1289,7 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 				for (int j = 0; j < i; j++)
 					free(mom->ops[j].data);
 				free(mom->ops);
-				free(pkt);
+				klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 				return -1;
 			} else {
 				memcpy(o->data, p + 4, o->data_length);
@@ -1310,14 +1331,20 @@ int parse_SCTE_104(struct klvanc_context_s *ctx,
 	}
 	else {
 		PRINT_ERR("%s() Unsupported opID = %x, error.\n", __func__, m->opID);
-		free(pkt);
+		klvanc_pool_put(ctx, VANC_TYPE_SCTE_104, pkt);
 		return -1;
 	}
 
-	ctx->callbacks->scte_104(ctx->callback_context, ctx, pkt);
+	KLVANC_CALLBACK(ctx, ctx->callbacks->scte_104(ctx->callback_context, ctx, pkt));
 
-	if (fullhdr)
+	if (fullhdr) {
+		/* Don't leave the decoded packet pointing at the released defrag words */
+		pkt->hdr.payload = NULL;
+		pkt->hdr.raw = NULL;
+		pkt->hdr.payloadLengthWords = 0;
+		pkt->hdr.rawLengthWords = 0;
 		klvanc_packet_free(fullhdr);
+	}
 
 	*pp = pkt;
 	return KLAPI_OK;
@@ -55,7 +55,7 @@ int parse_SDP(struct klvanc_context_s *ctx,
 		return -EINVAL;
 	}
 
-	struct klvanc_packet_sdp_s *pkt = calloc(1, sizeof(*pkt));
+	struct klvanc_packet_sdp_s *pkt = klvanc_pool_get(ctx, VANC_TYPE_SDP, sizeof(*pkt));
 	if (!pkt)
 		return -ENOMEM;
 
@@ -82,7 +82,7 @@ int parse_SDP(struct klvanc_context_s *ctx,
 	    ((uint16_t) (hdr->payload[9 + (45 * payloadBIndex) + 1] & 0xff) <<
 	     8) | (hdr->payload[9 + (45 * payloadBIndex) + 2] & 0xff);
 
-	ctx->callbacks->sdp(ctx->callback_context, ctx, pkt);
+	KLVANC_CALLBACK(ctx, ctx->callbacks->sdp(ctx->callback_context, ctx, pkt));
 
 	*pp = pkt;
 	return KLAPI_OK;
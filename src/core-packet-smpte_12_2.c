@@ -160,7 +160,7 @@ int parse_SMPTE_12_2(struct klvanc_context_s *ctx,
 	if (hdr->payloadLengthWords != 0x10)
 		return -EINVAL;
 
-	struct klvanc_packet_smpte_12_2_s *pkt = calloc(1, sizeof(*pkt));
+	struct klvanc_packet_smpte_12_2_s *pkt = klvanc_pool_get(ctx, VANC_TYPE_SMPTE_S12_2, sizeof(*pkt));
 	if (!pkt)
 		return -ENOMEM;
 
@@ -226,7 +226,7 @@ int parse_SMPTE_12_2(struct klvanc_context_s *ctx,
 			pkt->dbb1);
 	}
 
-	ctx->callbacks->smpte_12_2(ctx->callback_context, ctx, pkt);
+	KLVANC_CALLBACK(ctx, ctx->callbacks->smpte_12_2(ctx->callback_context, ctx, pkt));
 
 	*pp = pkt;
 	return KLAPI_OK;
@@ -81,23 +81,17 @@ int klvanc_dump_SMPTE_2108_1(struct klvanc_context_s *ctx, void *p)
 
 int parse_SMPTE_2108_1(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr, void **pp)
 {
-	struct klbs_context_s *bs;
+	struct klbs_context_s bitstream, *bs = &bitstream;
 
 	if (ctx->callbacks == NULL || ctx->callbacks->smpte_2108_1 == NULL)
 		return KLAPI_OK;
 
-	bs = klbs_alloc();
-	if (bs == NULL)
-		return -ENOMEM;
-
 	if (ctx->verbose)
 		PRINT_DEBUG("%s()\n", __func__);
 
-	struct klvanc_packet_smpte_2108_1_s *pkt = calloc(1, sizeof(*pkt));
-	if (!pkt) {
-		klbs_free(bs);
+	struct klvanc_packet_smpte_2108_1_s *pkt = klvanc_pool_get(ctx, VANC_TYPE_SMPTE_S2108_1, sizeof(*pkt));
+	if (!pkt)
 		return -ENOMEM;
-        }
 
 	memcpy(&pkt->hdr, hdr, sizeof(*hdr));
 
@@ -146,9 +140,7 @@ int parse_SMPTE_2108_1(struct klvanc_context_s *ctx, struct klvanc_packet_header
 		pkt->num_frames++;
 	}
 
-	ctx->callbacks->smpte_2108_1(ctx->callback_context, ctx, pkt);
-
-	klbs_free(bs);
+	KLVANC_CALLBACK(ctx, ctx->callbacks->smpte_2108_1(ctx->callback_context, ctx, pkt));
 
 	*pp = pkt;
 	return KLAPI_OK;
@@ -27,16 +27,14 @@
 #include <stdlib.h>
 #include <string.h>
 
-static int isValidHeader(struct klvanc_context_s *ctx, const unsigned short *arr, unsigned int len)
+static int isValidHeader(const unsigned short *arr, unsigned int len)
 {
 	int ret = 0;
-	if (len > 7) {
+	if (len >= 7) {
 		if ((*(arr + 0) < 3) && ((*(arr + 1) & 0x3fc) == 0x3fc) && ((*(arr + 2) & 0x3fc) == 0x3fc))
 			ret = 1;
 	}
 
-	if (ctx->verbose > 2)
-		PRINT_DEBUG("%04x %04x %04x %s\n", *(arr + 0), *(arr + 1), *(arr + 2), ret ? "valid": "invalid");
 	return ret;
 }
 
@@ -46,28 +44,18 @@ static struct type_s
 	enum klvanc_packet_type_e type;
 	int (*parse)(struct klvanc_context_s *, struct klvanc_packet_header_s *, void **);
 	int (*dump)(struct klvanc_context_s *, void *);
-	void (*free)(void *);
+	void (*release)(struct klvanc_context_s *, enum klvanc_packet_type_e, void *);
 } types[] = {
-	{ 0x40, 0xfe, VANC_TYPE_KL_UINT64_COUNTER, parse_KL_U64LE_COUNTER, klvanc_dump_KL_U64LE_COUNTER, free, },
-	{ 0x41, 0x05, VANC_TYPE_AFD, parse_AFD, klvanc_dump_AFD, free, },
-	{ 0x41, 0x07, VANC_TYPE_SCTE_104, parse_SCTE_104, klvanc_dump_SCTE_104, klvanc_free_SCTE_104, },
-	{ 0x60, 0x60, VANC_TYPE_SMPTE_S12_2, parse_SMPTE_12_2, klvanc_dump_SMPTE_12_2, free, },
-	{ 0x41, 0x0c, VANC_TYPE_SMPTE_S2108_1, parse_SMPTE_2108_1, klvanc_dump_SMPTE_2108_1, free, },
-	{ 0x61, 0x01, VANC_TYPE_EIA_708B, parse_EIA_708B, klvanc_dump_EIA_708B, free, },
-	{ 0x61, 0x02, VANC_TYPE_EIA_608, parse_EIA_608, klvanc_dump_EIA_608, free, },
-	{ 0x43, 0x02, VANC_TYPE_SDP, parse_SDP, klvanc_dump_SDP, free, },
+	{ 0x40, 0xfe, VANC_TYPE_KL_UINT64_COUNTER, parse_KL_U64LE_COUNTER, klvanc_dump_KL_U64LE_COUNTER, klvanc_pool_put, },
+	{ 0x41, 0x05, VANC_TYPE_AFD, parse_AFD, klvanc_dump_AFD, klvanc_pool_put, },
+	{ 0x41, 0x07, VANC_TYPE_SCTE_104, parse_SCTE_104, klvanc_dump_SCTE_104, release_SCTE_104, },
+	{ 0x60, 0x60, VANC_TYPE_SMPTE_S12_2, parse_SMPTE_12_2, klvanc_dump_SMPTE_12_2, klvanc_pool_put, },
+	{ 0x41, 0x0c, VANC_TYPE_SMPTE_S2108_1, parse_SMPTE_2108_1, klvanc_dump_SMPTE_2108_1, klvanc_pool_put, },
+	{ 0x61, 0x01, VANC_TYPE_EIA_708B, parse_EIA_708B, klvanc_dump_EIA_708B, klvanc_pool_put, },
+	{ 0x61, 0x02, VANC_TYPE_EIA_608, parse_EIA_608, klvanc_dump_EIA_608, klvanc_pool_put, },
+	{ 0x43, 0x02, VANC_TYPE_SDP, parse_SDP, klvanc_dump_SDP, klvanc_pool_put, },
 };
 
-static enum klvanc_packet_type_e lookupTypeByDID(unsigned short did, unsigned short sdid)
-{
-	for (int i = 0; i < (sizeof(types) / sizeof(struct type_s)); i++) {
-		if ((types[i].did == did) && (types[i].sdid == sdid))
-			return types[i].type;
-	}
-
-	return VANC_TYPE_UNDEFINED;
-}
-
 const char *klvanc_lookupDescriptionByType(enum klvanc_packet_type_e type)
 {
 	for (int i = 0; i < (sizeof(types) / sizeof(struct type_s)); i++) {
@@ -90,82 +78,104 @@ const char *klvanc_lookupSpecificationByType(enum klvanc_packet_type_e type)
 	return "UNDEFINED";
 }
 
-static int freeByType(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr, void *pp)
+int klvanc_decoders_alloc(struct klvanc_context_s *ctx)
 {
 	for (int i = 0; i < (sizeof(types) / sizeof(struct type_s)); i++) {
-		if ((types[i].type == hdr->type) && (types[i].free)) {
-			types[i].free(pp);
-			return 0;
+		struct vanc_decoder_s *dec = klvanc_decoder_slot(ctx, types[i].did, types[i].sdid);
+		if (!dec) {
+			klvanc_decoders_free(ctx);
+			return -ENOMEM;
 		}
+		dec->type = types[i].type;
+		dec->parse = types[i].parse;
+		dec->dump = types[i].dump;
+		dec->free = NULL;
+		dec->release = types[i].release;
+		dec->cb = NULL;
 	}
 
-	return -EINVAL;
+	return KLAPI_OK;
 }
 
-static int parseByType(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr, void **pp)
+void klvanc_decoders_free(struct klvanc_context_s *ctx)
 {
-	*pp = 0;
-	for (int i = 0; i < (sizeof(types) / sizeof(struct type_s)); i++) {
-		if ((types[i].type == hdr->type) && (types[i].parse))
-			return types[i].parse(ctx, hdr, pp);
-	}
+	struct vanc_context_private_s *priv = getPrivate(ctx);
 
-	return -EINVAL;
+	for (int i = 0; i < 256; i++) {
+		free(priv->decoders[i]);
+		priv->decoders[i] = NULL;
+	}
 }
 
-static int dumpByType(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr)
+struct vanc_decoder_s *klvanc_decoder_slot(struct klvanc_context_s *ctx, uint8_t did, uint8_t sdid)
 {
-	for (int i = 0; i < (sizeof(types) / sizeof(struct type_s)); i++) {
-		if ((types[i].type == hdr->type) && (types[i].dump))
-			return types[i].dump(ctx, hdr);
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+
+	/* Rows are only allocated for DIDs that have at least one decoder */
+	if (!priv->decoders[did]) {
+		priv->decoders[did] = calloc(256, sizeof(struct vanc_decoder_s));
+		if (!priv->decoders[did])
+			return NULL;
 	}
 
-	return -EINVAL;
+	return &priv->decoders[did][sdid];
 }
 
-static int parse(struct klvanc_context_s *ctx, const unsigned short *arr, unsigned int len,
-	struct klvanc_packet_header_s **hdr)
+int klvanc_register_decoder(struct klvanc_context_s *ctx, uint8_t did, uint8_t sdid,
+	int (*parse)(struct klvanc_context_s *, struct klvanc_packet_header_s *, void **),
+	void (*free)(void *),
+	int (*cb)(void *, struct klvanc_context_s *, struct klvanc_packet_header_s *, void *))
 {
-	if (!isValidHeader(ctx, arr, len)) {
+	VALIDATE(ctx);
+	VALIDATE(parse);
+
+	struct vanc_decoder_s *dec = klvanc_decoder_slot(ctx, did, sdid);
+	if (!dec)
+		return -ENOMEM;
+
+	/* Replacing a builtin decoder keeps its packet type, anything else is undefined. */
+	dec->parse = parse;
+	dec->dump = NULL;
+	dec->free = free;
+	dec->release = NULL;
+	dec->cb = cb;
+
+	return KLAPI_OK;
+}
+
+/* Build a header view over the packet at arr. No words are copied, payload and raw
+ * point straight into the caller's buffer. Touches nothing but p, so is safe to
+ * call from the frame parsing worker threads.
+ */
+int klvanc_packet_view(const unsigned short *arr, unsigned int len, struct klvanc_packet_header_s *p)
+{
+	if (!isValidHeader(arr, len)) {
 		return -EINVAL;
 	}
 
-	struct klvanc_packet_header_s *p = calloc(1, sizeof(struct klvanc_packet_header_s));
-	if (!p)
-		return -ENOMEM;
+	p->payloadLengthWords = sanitizeWord(*(arr + 5));
+
+	/* ADF + DID + SDID + DC, payload, checksum. Reject packets truncated by the end of the line */
+	if (p->payloadLengthWords + 7 > len)
+		return -EINVAL;
 
-	/* Place the entire raw frame passed into raw words, but update raw length
-	 * to reflect the detected payload size plus a minor overheader to compenate
-	 * for a few leading header and trailer words.
-	 */
-	memcpy(&p->raw[0], arr, len * sizeof(unsigned short));
 	p->adf[0] = *(arr + 0);
 	p->adf[1] = *(arr + 1);
 	p->adf[2] = *(arr + 2);
 	p->did = sanitizeWord(*(arr + 3));
 	p->dbnsdid = sanitizeWord(*(arr + 4));
 
-	p->payloadLengthWords = sanitizeWord(*(arr + 5));
-	p->rawLengthWords = p->payloadLengthWords + 8;
-	p->rawLengthWords = len;
-	if (p->payloadLengthWords > (sizeof(p->payload) / sizeof(unsigned short))) {
-		free(p);
-		return -ENOMEM;
-	}
-
-	int i;
-	for (i = 0; i < p->payloadLengthWords; i++) {
-		p->payload[i] = *(arr + 6 + i);
-	}
-	p->checksum = *(arr + 6 + i);
-	p->checksumValid = klvanc_checksum_is_valid(arr + 3,
-		p->payloadLengthWords + 4 /* payload + header + len + crc */);
-	if (!p->checksumValid)
-		ctx->checksum_failures++;
+	p->raw = (unsigned short *)arr;
+	p->rawLengthWords = p->payloadLengthWords + 7;
+	p->payload = p->raw + 6;
+	p->allocLengthWords = 0;
 
-	p->type = lookupTypeByDID(p->did, p->dbnsdid);
+	/* Checksum and parity of DID, SDID, DC and the payload, in a single pass */
+	int parityValid;
+	p->checksum = *(arr + 6 + p->payloadLengthWords);
+	p->checksumValid = klvanc_checksum_parity(arr + 3, p->payloadLengthWords + 3, &parityValid) == p->checksum;
+	p->parityValid = parityValid;
 
-	*hdr = p;
 	return KLAPI_OK;
 }
 
@@ -211,78 +221,167 @@ void klvanc_dump_packet_console(struct klvanc_context_s *ctx, struct klvanc_pack
 	PRINT_DEBUG("\n");
 }
 
-int klvanc_packet_parse(struct klvanc_context_s *ctx, unsigned int lineNr, const unsigned short *arr, unsigned int len)
+void klvanc_packet_deliver(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr)
 {
-	int attempts = 0;
-	VALIDATE(ctx);
-	VALIDATE(arr);
-	VALIDATE(len);
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	uint64_t begin = klvanc_stats_begin(ctx);
+	int decodeFailed = 0;
+	int ret;
 
-	if (len > LIBKLVANC_PACKET_MAX_PAYLOAD) {
-		/* Safety */
-		PRINT_ERR("%s() length %d exceeds %d, ignoring.\n", __func__, len, LIBKLVANC_PACKET_MAX_PAYLOAD);
-		return -EINVAL;
+	if (!hdr->checksumValid)
+		ctx->checksum_failures++;
+
+	/* Single O(1) lookup for type, parse, dump and free */
+	const struct vanc_decoder_s *dec = klvanc_decoder_lookup(ctx, hdr->did, hdr->dbnsdid);
+	hdr->type = dec ? dec->type : VANC_TYPE_UNDEFINED;
+
+	/* Dump the packet header and basic VANC types if required. */
+	if (ctx->verbose)
+		klvanc_dump_packet_console(ctx, hdr);
+
+	/* Update the internal VANC cache */
+	klvanc_cache_update(ctx, hdr);
+
+	/* Packets identical to the last one at their position are delivered from the memo */
+	struct vanc_memo_entry_s *memo = NULL;
+	int unchanged = 0;
+	if (priv->memo && (hdr->checksumValid || ctx->allow_bad_checksums))
+		unchanged = klvanc_memo_deliver(ctx, hdr, dec, &memo);
+
+	if (!unchanged && (hdr->checksumValid || ctx->allow_bad_checksums)) {
+		if (ctx->callbacks && ctx->callbacks->all)
+			KLVANC_CALLBACK(ctx, ctx->callbacks->all(ctx->callback_context, ctx, hdr));
+
+		if (priv->frameCollect)
+			klvanc_frame_collect(ctx, hdr);
+
+		/* formally decode the entire packet */
+		void *decodedPacket = NULL;
+		uint64_t decodeBegin = dec ? klvanc_stats_begin(ctx) : 0;
+		uint64_t callbackNs = priv->stats.callbackNs;
+		ret = dec ? dec->parse(ctx, hdr, &decodedPacket) : -EINVAL;
+		if (decodeBegin)
+			klvanc_stats_decode(ctx, decodeBegin, callbackNs);
+		if (ret == KLAPI_OK) {
+			/* Application registered decoders get their callback from us,
+			 * builtin decoders fire theirs during parse.
+			 */
+			if (dec->cb && decodedPacket)
+				KLVANC_CALLBACK(ctx, dec->cb(ctx->callback_context, ctx, hdr, decodedPacket));
+
+			if (ctx->verbose == 2 && decodedPacket && dec->dump) {
+				ret = dec->dump(ctx, decodedPacket);
+				if (ret < 0) {
+					PRINT_ERR("Failed to dump by type, missing dumper function?\n");
+				}
+			}
+		} else {
+			decodeFailed = dec != NULL;
+			if (ctx->warn_on_decode_failure) {
+				if (klrestricted_code_path_block_execute(&ctx->rcp_failedToDecode)) {
+					PRINT_ERR("Failed parsing by type\n");
+					klvanc_dump_packet_console(ctx, hdr);
+				}
+			}
+		}
+
+		/* The memo keeps a successfully decoded struct until the packet changes */
+		if (memo && !decodeFailed) {
+			klvanc_memo_store(memo, dec, decodedPacket);
+			decodedPacket = NULL;
+		}
+
+		if (decodedPacket && dec->release)
+			dec->release(ctx, dec->type, decodedPacket);
+		else if (decodedPacket && dec->free)
+			dec->free(decodedPacket);
 	}
 
-	/* Scan the entire line for vanc frames */
+	if (begin)
+		klvanc_stats_packet(ctx, hdr, decodeFailed, begin);
+}
+
+int klvanc_packet_process(struct klvanc_context_s *ctx, unsigned int lineNr, unsigned int horizontalOffset,
+			  const unsigned short *arr, unsigned int len)
+{
+	/* Do a basic header parse */
+	struct klvanc_packet_header_s view, *hdr = &view;
+	int ret = klvanc_packet_view(arr, len, hdr);
+
+	if (ctx->verbose > 2)
+		PRINT_DEBUG("%04x %04x %04x %s\n", *(arr + 0), *(arr + 1), *(arr + 2), ret == 0 ? "valid": "invalid");
+	if (ret < 0)
+		return ret;
+
+	hdr->horizontalOffset = horizontalOffset;
+	hdr->lineNr = lineNr;
+
+	klvanc_packet_deliver(ctx, hdr);
+
+	return hdr->rawLengthWords;
+}
+
+int klvanc_packet_scan(struct klvanc_context_s *ctx, unsigned int lineNr, const unsigned short *arr, unsigned int len)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	int attempts = 0;
+
+	/* Scan the entire line for vanc frames, jumping from one candidate ADF to the next */
 	unsigned int i = 0;
 	while (i < len - 7) {
-		/* Do a basic header parse */
-		struct klvanc_packet_header_s *hdr;
-		int ret = parse(ctx, arr + i, len - i, &hdr);
-		if (ret < 0) {
-			i++;
+		i = klvanc_adf_find(arr, i, len - 7);
+		if (i >= len - 7)
+			break;
+
+		/* Skip over packets the application hasn't subscribed to, before doing any work on them */
+		if (!klvanc_packet_subscribed(priv, arr[i + 3], arr[i + 4])) {
+			i += sanitizeWord(arr[i + 5]) + 7;
 			continue;
 		}
 
-		hdr->horizontalOffset = i;
-		hdr->lineNr = lineNr;
-
-		/* Dump the packet header and basic VANC types if required. */
-		if (ctx->verbose)
-			klvanc_dump_packet_console(ctx, hdr);
+		int words = klvanc_packet_process(ctx, lineNr, i, arr + i, len - i);
+		if (words < 0) {
+			i++;
+			continue;
+		}
 
 		/* The number of frames we attempted to parse */
 		attempts++;
 
-		/* Update the internal VANC cache */
-		klvanc_cache_update(ctx, hdr);
-
-		if (hdr->checksumValid || ctx->allow_bad_checksums) {
-			if (ctx->callbacks && ctx->callbacks->all)
-				ctx->callbacks->all(ctx->callback_context, ctx, hdr);
-
-			/* formally decode the entire packet */
-			void *decodedPacket = NULL;
-			ret = parseByType(ctx, hdr, &decodedPacket);
-			if (ret == KLAPI_OK) {
-				if (ctx->verbose == 2 && decodedPacket) {
-					ret = dumpByType(ctx, decodedPacket);
-					if (ret < 0) {
-						PRINT_ERR("Failed to dump by type, missing dumper function?\n");
-					}
-				}
-			} else {
-				if (ctx->warn_on_decode_failure) {
-					if (klrestricted_code_path_block_execute(&ctx->rcp_failedToDecode)) {
-						PRINT_ERR("Failed parsing by type\n");
-						klvanc_dump_packet_console(ctx, hdr);
-					}
-				}
-			}
+		/* Resume scanning after the packet, packets are contiguous (ST291-1 Sec 7.3)
+		 * so the next ADF is typically the very next word.
+		 */
+		i += words;
+	}
 
-			if (decodedPacket)
-				freeByType(ctx, hdr, decodedPacket);
-		}
+	return attempts;
+}
 
-		free(hdr);
+int klvanc_packet_parse(struct klvanc_context_s *ctx, unsigned int lineNr, const unsigned short *arr, unsigned int len)
+{
+	int attempts = 0;
+	VALIDATE(ctx);
+	VALIDATE(arr);
+	VALIDATE(len);
 
-		/* Minimum packet length is 7, so lets move things
-		 * on a little faster....
-		 */
-		i += 7;
+	if (len > LIBKLVANC_PACKET_MAX_PAYLOAD) {
+		/* Safety */
+		PRINT_ERR("%s() length %d exceeds %d, ignoring.\n", __func__, len, LIBKLVANC_PACKET_MAX_PAYLOAD);
+		return -EINVAL;
 	}
 
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	if (!klvanc_line_subscribed(priv, lineNr))
+		return 0;
+
+	uint64_t begin = klvanc_stats_begin(ctx);
+	uint64_t deliverNs = priv->stats.deliverNs;
+
+	attempts = klvanc_packet_scan(ctx, lineNr, arr, len);
+
+	if (begin)
+		klvanc_stats_scan(ctx, begin, deliverNs, len * sizeof(unsigned short));
+
 	return attempts;
 }
 
@@ -308,25 +407,12 @@ int klvanc_sdi_create_payload(uint8_t sdid, uint8_t did,
 	for (int i = 0; i < srcByteCount; i++)
 		*(v++) = *(src + i);
 
-	/* Generate Parity
+	/* Generate Parity and checksum
 	 * VANC header 0/3ff/3ff = 3
 	 * sdid/did/count = 3
 	 */
-	for (int i = 3; i < (srcByteCount + 3 + 3); i++) {
-		if (__builtin_parity(arr[i]))
-			arr[i] |= 0x100;
-		else
-			arr[i] |= 0x200;
-	}
-
-	/* Calculate checksum */
-	uint16_t sum = 0;
-	int i;
-	for (i = 3; i < (srcByteCount + 3 + 3); i++) {
-		sum += arr[i];
-		sum &= 0x1ff;
-	}
-	*(v++) = sum | ((~sum & 0x100) << 1);
+	klvanc_parity_generate(arr + 3, srcByteCount + 3);
+	*(v++) = klvanc_checksum_parity(arr + 3, srcByteCount + 3, NULL);
 
 	*dstWordCount = v - arr;
 	*dst = arr;
@@ -334,13 +420,41 @@ int klvanc_sdi_create_payload(uint8_t sdid, uint8_t did,
 	return 0;
 }
 
+int klvanc_packet_alloc(struct klvanc_packet_header_s **dst, const struct klvanc_packet_header_s *src,
+			unsigned int words)
+{
+	/* Header, raw words and payload words in a single allocation, so klvanc_packet_free()
+	 * remains a plain free().
+	 */
+	struct klvanc_packet_header_s *p = malloc(sizeof(*p) + (words * 2 * sizeof(unsigned short)));
+	if (p == NULL)
+		return -ENOMEM;
+
+	*p = *src;
+	p->raw = (unsigned short *)(p + 1);
+	p->payload = p->raw + words;
+	p->rawLengthWords = 0;
+	p->payloadLengthWords = 0;
+	p->allocLengthWords = words;
+
+	*dst = p;
+	return 0;
+}
+
 int klvanc_packet_copy(struct klvanc_packet_header_s **dst, struct klvanc_packet_header_s *src)
 {
-	*dst = malloc(sizeof(*src));
-	if (*dst == NULL)
+	unsigned int words = src->rawLengthWords;
+	if (words < src->payloadLengthWords)
+		words = src->payloadLengthWords;
+
+	if (klvanc_packet_alloc(dst, src, words) < 0)
 		return -ENOMEM;
 
-	memcpy(*dst, src, sizeof(*src));
+	memcpy((*dst)->raw, src->raw, src->rawLengthWords * sizeof(unsigned short));
+	(*dst)->rawLengthWords = src->rawLengthWords;
+	memcpy((*dst)->payload, src->payload, src->payloadLengthWords * sizeof(unsigned short));
+	(*dst)->payloadLengthWords = src->payloadLengthWords;
+
 	return 0;
 }
 
@@ -384,7 +498,15 @@ int klvanc_packet_save(const char *dir, const struct klvanc_packet_header_s *pkt
 		 *       writing rawPayloadLength is always (think good or bad long vanc messages)
 		 *       the correct thing to do. This will suffice for the time being.
 		 */
-		fwrite(pkt->raw, 2, pkt->payloadLengthWords + 6 /* header */ + 4 /* trailing padding */, fh);
+		unsigned int words = pkt->payloadLengthWords + 6 /* header */ + 4 /* trailing padding */;
+		if (words > pkt->rawLengthWords)
+			words = pkt->rawLengthWords;
+		fwrite(pkt->raw, 2, words, fh);
+
+		/* The raw words end at the checksum, pad out with zeros as before */
+		const unsigned short pad = 0;
+		for (; words < pkt->payloadLengthWords + 6 + 4; words++)
+			fwrite(&pad, 2, 1, fh);
 		fclose(fh);
 	} else {
 		fprintf(stderr, "Unable to create %s\n", fn);
@@ -395,12 +517,13 @@ int klvanc_packet_save(const char *dir, const struct klvanc_packet_header_s *pkt
 
 int klvanc_packet_payload_append(struct klvanc_packet_header_s *dst, struct klvanc_packet_header_s *src, int srcOffset)
 {
-	if (dst->payloadLengthWords + (src->payloadLengthWords - srcOffset) > LIBKLVANC_PACKET_MAX_PAYLOAD) {
+	if (dst->payloadLengthWords + (src->payloadLengthWords - srcOffset) > LIBKLVANC_PACKET_MAX_PAYLOAD ||
+	    dst->payloadLengthWords + (src->payloadLengthWords - srcOffset) > dst->allocLengthWords) {
 		fprintf(stderr, "%s() Payload Overflow avoided\n", __func__);
 		return -1;
 	}
 
-	if (dst->rawLengthWords + src->rawLengthWords > LIBKLVANC_PACKET_MAX_PAYLOAD) {
+	if (dst->rawLengthWords + src->rawLengthWords > dst->allocLengthWords) {
 		fprintf(stderr, "%s() Raw Overflow avoided\n", __func__);
 		return -1;
 	}
@@ -27,6 +27,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+
+#if KLVANC_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
 
 #define av_le2ne32(x) (x)
 
@@ -55,17 +60,10 @@ void klvanc_v210_planar_unpack_c(const uint32_t * src, uint16_t * y, uint16_t *
  * Twelve 10-bit unsigned components are packed into four 32-bit little-endian words.
  * See BlackMagic SDK page 280 for a detailed description.
  */
-int klvanc_v210_line_to_nv20_c(const uint32_t * src, uint16_t * dst, int dstSizeBytes, int width)
+static void v210_line_to_nv20(const uint32_t * src, uint16_t * dst, uint16_t * uv, int width)
 {
-	if (!src || !dst || !width)
-		return -1;
-
-	if (dstSizeBytes < (width * 6))
-		return -1;
-
 	int w;
 	uint32_t val = 0;
-	uint16_t *uv = dst + width;
 	for (w = 0; w < (width - 5); w += 6) {
 		READ_PIXELS(uv, dst, uv);
 		READ_PIXELS(dst, uv, dst);
@@ -88,6 +86,17 @@ int klvanc_v210_line_to_nv20_c(const uint32_t * src, uint16_t * dst, int dstSize
 		*uv++ = val & 0x3ff;
 		*dst++ = (val >> 10) & 0x3ff;
 	}
+}
+
+int klvanc_v210_line_to_nv20_c(const uint32_t * src, uint16_t * dst, int dstSizeBytes, int width)
+{
+	if (!src || !dst || !width)
+		return -1;
+
+	if (dstSizeBytes < (width * 6))
+		return -1;
+
+	v210_line_to_nv20(src, dst, dst + width, width);
 
 	return 0;
 }
@@ -122,6 +131,464 @@ void klvanc_v210_line_to_uyvy_c(const uint32_t * src, uint16_t * dst, int width)
 	}
 }
 
+/* Luma only, for HD where ANC normally travels in the Y stream (ST 292).
+ * Writes width words.
+ */
+void klvanc_v210_line_to_y10_c(const uint32_t * src, uint16_t * dst, int width)
+{
+	static const uint8_t dword[6] = { 0, 1, 1, 2, 3, 3 };
+	static const uint8_t shift[6] = { 10, 0, 20, 10, 0, 20 };
+	int w;
+
+	for (w = 0; w < (width - 5); w += 6) {
+		*dst++ = (av_le2ne32(src[0]) >> 10) & 0x3ff;
+		*dst++ = av_le2ne32(src[1]) & 0x3ff;
+		*dst++ = (av_le2ne32(src[1]) >> 20) & 0x3ff;
+		*dst++ = (av_le2ne32(src[2]) >> 10) & 0x3ff;
+		*dst++ = av_le2ne32(src[3]) & 0x3ff;
+		*dst++ = (av_le2ne32(src[3]) >> 20) & 0x3ff;
+		src += 4;
+	}
+
+	/* Partial group */
+	for (int n = 0; w + n < width; n++)
+		*dst++ = (av_le2ne32(src[dword[n]]) >> shift[n]) & 0x3ff;
+}
+
+/* SIMD unpackers. Every kernel works on pairs of 6 pixel groups, 32 bytes of v210
+ * yielding 24 components, and hands whatever remains to the C versions above.
+ *
+ * Each 16 bit output word is gathered from the two bytes holding its component,
+ * the three component positions in a dword are then aligned with a multiply by
+ * 16, 4 or 1 (SSSE3 has no per lane shift) and a common shift and mask. The
+ * AVX2 and AVX-512 kernels run the same sequence on two and four pairs at a
+ * time, one pair per 128 bit lane, and share the SSSE3 store helpers.
+ */
+#if KLVANC_HAVE_X86_SIMD
+#define V210_SHUF0 0, 1, 1, 2, 2, 3, 4, 5, 5, 6, 6, 7, 8, 9, 9, 10
+#define V210_SHUF1 2, 3, 4, 5, 5, 6, 6, 7, 8, 9, 9, 10, 10, 11, 12, 13
+#define V210_SHUF2 5, 6, 6, 7, 8, 9, 9, 10, 10, 11, 12, 13, 13, 14, 14, 15
+#define V210_MUL0 16, 4, 1, 16, 4, 1, 16, 4
+#define V210_MUL1 1, 16, 4, 1, 16, 4, 1, 16
+#define V210_MUL2 4, 1, 16, 4, 1, 16, 4, 1
+
+/* Components of a 24 word pair, with the even (chroma) words in the low half
+ * and the odd (luma) words in the high half.
+ */
+#define V210_SHUF_NV20 0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15
+/* Luma in the low half, then Cb, Cb, Cr, Cr */
+#define V210_SHUF_PLANAR 2, 3, 6, 7, 10, 11, 14, 15, 0, 1, 8, 9, 4, 5, 12, 13
+
+__attribute__((target("ssse3")))
+static inline __m128i v210_component_ssse3(__m128i x, __m128i shuf, __m128i mul)
+{
+	x = _mm_mullo_epi16(_mm_shuffle_epi8(x, shuf), mul);
+	return _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi16(0x3ff));
+}
+
+__attribute__((target("ssse3")))
+static inline void v210_unpack_ssse3(const uint8_t *src, __m128i *w)
+{
+	__m128i in0 = _mm_loadu_si128((const __m128i *)src);
+	__m128i in1 = _mm_loadu_si128((const __m128i *)(src + 16));
+
+	w[0] = v210_component_ssse3(in0, _mm_setr_epi8(V210_SHUF0), _mm_setr_epi16(V210_MUL0));
+	w[1] = v210_component_ssse3(_mm_alignr_epi8(in1, in0, 8), _mm_setr_epi8(V210_SHUF1),
+				    _mm_setr_epi16(V210_MUL1));
+	w[2] = v210_component_ssse3(in1, _mm_setr_epi8(V210_SHUF2), _mm_setr_epi16(V210_MUL2));
+}
+
+__attribute__((target("ssse3")))
+static inline void v210_store_uyvy_ssse3(const __m128i *w, uint16_t *dst)
+{
+	_mm_storeu_si128((__m128i *)dst, w[0]);
+	_mm_storeu_si128((__m128i *)(dst + 8), w[1]);
+	_mm_storeu_si128((__m128i *)(dst + 16), w[2]);
+}
+
+__attribute__((target("ssse3")))
+static inline void v210_store_nv20_ssse3(const __m128i *w, uint16_t *y, uint16_t *uv)
+{
+	const __m128i shuf = _mm_setr_epi8(V210_SHUF_NV20);
+	__m128i s0 = _mm_shuffle_epi8(w[0], shuf);
+	__m128i s1 = _mm_shuffle_epi8(w[1], shuf);
+	__m128i s2 = _mm_shuffle_epi8(w[2], shuf);
+
+	_mm_storeu_si128((__m128i *)uv, _mm_unpacklo_epi64(s0, s1));
+	_mm_storel_epi64((__m128i *)(uv + 8), s2);
+	_mm_storeu_si128((__m128i *)y, _mm_unpackhi_epi64(s0, s1));
+	_mm_storel_epi64((__m128i *)(y + 8), _mm_unpackhi_epi64(s2, s2));
+}
+
+__attribute__((target("ssse3")))
+static inline void v210_store_planar_ssse3(const __m128i *w, uint16_t *y, uint16_t *u, uint16_t *v)
+{
+	const __m128i shuf = _mm_setr_epi8(V210_SHUF_PLANAR);
+	__m128i s0 = _mm_shuffle_epi8(w[0], shuf);
+	__m128i s1 = _mm_shuffle_epi8(w[1], shuf);
+	__m128i s2 = _mm_shuffle_epi8(w[2], shuf);
+	__m128i uv = _mm_unpackhi_epi32(s0, s1);
+	uint32_t last;
+
+	_mm_storeu_si128((__m128i *)y, _mm_unpacklo_epi64(s0, s1));
+	_mm_storel_epi64((__m128i *)(y + 8), s2);
+	_mm_storel_epi64((__m128i *)u, uv);
+	_mm_storel_epi64((__m128i *)v, _mm_unpackhi_epi64(uv, uv));
+	last = _mm_cvtsi128_si32(_mm_srli_si128(s2, 8));
+	memcpy(u + 4, &last, sizeof(last));
+	last = _mm_cvtsi128_si32(_mm_srli_si128(s2, 12));
+	memcpy(v + 4, &last, sizeof(last));
+}
+
+/* The six luma samples of a group, in the low 12 bytes */
+#define V210_SHUF_Y10 1, 2, 4, 5, 6, 7, 9, 10, 12, 13, 14, 15, 0x80, 0x80, 0x80, 0x80
+#define V210_MUL_Y10 4, 16, 1, 4, 16, 1, 0, 0
+
+/* Groups of 6 pixels each routine converts, rounded down to whole pairs */
+#define V210_PAIRS_PLANAR(width) (((width) > 0 ? (width) / 6 : 0) / 2)
+#define V210_PAIRS_UYVY(width) (((width) > 0 ? ((width) + 5) / 6 : 0) / 2)
+
+__attribute__((target("ssse3")))
+static void v210_planar_unpack_ssse3(const uint32_t * src, uint16_t * y, uint16_t * u, uint16_t * v, int width)
+{
+	int pairs = V210_PAIRS_PLANAR(width);
+	__m128i w[3];
+
+	for (int i = 0; i < pairs; i++) {
+		v210_unpack_ssse3((const uint8_t *)(src + i * 8), w);
+		v210_store_planar_ssse3(w, y + i * 12, u + i * 6, v + i * 6);
+	}
+
+	klvanc_v210_planar_unpack_c(src + pairs * 8, y + pairs * 12, u + pairs * 6, v + pairs * 6,
+				    width - pairs * 12);
+}
+
+__attribute__((target("ssse3")))
+static int v210_line_to_nv20_ssse3(const uint32_t * src, uint16_t * dst, int dstSizeBytes, int width)
+{
+	if (!src || !dst || !width)
+		return -1;
+
+	if (dstSizeBytes < (width * 6))
+		return -1;
+
+	int pairs = V210_PAIRS_PLANAR(width);
+	uint16_t *uv = dst + width;
+	__m128i w[3];
+
+	for (int i = 0; i < pairs; i++) {
+		v210_unpack_ssse3((const uint8_t *)(src + i * 8), w);
+		v210_store_nv20_ssse3(w, dst + i * 12, uv + i * 12);
+	}
+
+	v210_line_to_nv20(src + pairs * 8, dst + pairs * 12, uv + pairs * 12, width - pairs * 12);
+
+	return 0;
+}
+
+__attribute__((target("ssse3")))
+static void v210_line_to_uyvy_ssse3(const uint32_t * src, uint16_t * dst, int width)
+{
+	int pairs = V210_PAIRS_UYVY(width);
+	__m128i w[3];
+
+	for (int i = 0; i < pairs; i++) {
+		v210_unpack_ssse3((const uint8_t *)(src + i * 8), w);
+		v210_store_uyvy_ssse3(w, dst + i * 24);
+	}
+
+	klvanc_v210_line_to_uyvy_c(src + pairs * 8, dst + pairs * 24, width - pairs * 12);
+}
+
+/* Luma needs no pairing, each group is gathered on its own */
+__attribute__((target("ssse3")))
+static void v210_line_to_y10_ssse3(const uint32_t * src, uint16_t * dst, int width)
+{
+	int groups = width > 0 ? width / 6 : 0;
+	uint32_t last;
+
+	for (int g = 0; g < groups; g++) {
+		__m128i x = v210_component_ssse3(_mm_loadu_si128((const __m128i *)(src + g * 4)),
+						 _mm_setr_epi8(V210_SHUF_Y10), _mm_setr_epi16(V210_MUL_Y10));
+		_mm_storel_epi64((__m128i *)(dst + g * 6), x);
+		last = _mm_cvtsi128_si32(_mm_srli_si128(x, 8));
+		memcpy(dst + g * 6 + 4, &last, sizeof(last));
+	}
+
+	klvanc_v210_line_to_y10_c(src + groups * 4, dst + groups * 6, width - groups * 6);
+}
+
+/* Two pairs, the first in the low lane of each result and the second in the high lane.
+ * The AVX2 and AVX-512 kernels hand their remainder to SSE code, which GCC doesn't
+ * guard with vzeroupper when it's a sibling call, so each does its own first.
+ */
+__attribute__((target("avx2")))
+static inline void v210_unpack_avx2(const uint8_t *src, __m128i *lo, __m128i *hi)
+{
+	__m256i in0 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)src)),
+					      _mm_loadu_si128((const __m128i *)(src + 32)), 1);
+	__m256i in1 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(src + 16))),
+					      _mm_loadu_si128((const __m128i *)(src + 48)), 1);
+	__m256i x[3];
+
+	x[0] = _mm256_mullo_epi16(_mm256_shuffle_epi8(in0, _mm256_setr_epi8(V210_SHUF0, V210_SHUF0)),
+				  _mm256_setr_epi16(V210_MUL0, V210_MUL0));
+	x[1] = _mm256_mullo_epi16(_mm256_shuffle_epi8(_mm256_alignr_epi8(in1, in0, 8),
+						      _mm256_setr_epi8(V210_SHUF1, V210_SHUF1)),
+				  _mm256_setr_epi16(V210_MUL1, V210_MUL1));
+	x[2] = _mm256_mullo_epi16(_mm256_shuffle_epi8(in1, _mm256_setr_epi8(V210_SHUF2, V210_SHUF2)),
+				  _mm256_setr_epi16(V210_MUL2, V210_MUL2));
+
+	for (int i = 0; i < 3; i++) {
+		x[i] = _mm256_and_si256(_mm256_srli_epi16(x[i], 4), _mm256_set1_epi16(0x3ff));
+		lo[i] = _mm256_castsi256_si128(x[i]);
+		hi[i] = _mm256_extracti128_si256(x[i], 1);
+	}
+}
+
+__attribute__((target("avx2")))
+static void v210_planar_unpack_avx2(const uint32_t * src, uint16_t * y, uint16_t * u, uint16_t * v, int width)
+{
+	int pairs = V210_PAIRS_PLANAR(width) & ~1;
+	__m128i lo[3], hi[3];
+
+	for (int i = 0; i < pairs; i += 2) {
+		v210_unpack_avx2((const uint8_t *)(src + i * 8), lo, hi);
+		v210_store_planar_ssse3(lo, y + i * 12, u + i * 6, v + i * 6);
+		v210_store_planar_ssse3(hi, y + i * 12 + 12, u + i * 6 + 6, v + i * 6 + 6);
+	}
+
+	_mm256_zeroupper();
+	v210_planar_unpack_ssse3(src + pairs * 8, y + pairs * 12, u + pairs * 6, v + pairs * 6,
+				 width - pairs * 12);
+}
+
+__attribute__((target("avx2")))
+static int v210_line_to_nv20_avx2(const uint32_t * src, uint16_t * dst, int dstSizeBytes, int width)
+{
+	if (!src || !dst || !width)
+		return -1;
+
+	if (dstSizeBytes < (width * 6))
+		return -1;
+
+	int pairs = V210_PAIRS_PLANAR(width) & ~1;
+	uint16_t *uv = dst + width;
+	__m128i lo[3], hi[3];
+
+	for (int i = 0; i < pairs; i += 2) {
+		v210_unpack_avx2((const uint8_t *)(src + i * 8), lo, hi);
+		v210_store_nv20_ssse3(lo, dst + i * 12, uv + i * 12);
+		v210_store_nv20_ssse3(hi, dst + i * 12 + 12, uv + i * 12 + 12);
+	}
+
+	_mm256_zeroupper();
+	v210_line_to_nv20(src + pairs * 8, dst + pairs * 12, uv + pairs * 12, width - pairs * 12);
+
+	return 0;
+}
+
+__attribute__((target("avx2")))
+static void v210_line_to_uyvy_avx2(const uint32_t * src, uint16_t * dst, int width)
+{
+	int pairs = V210_PAIRS_UYVY(width) & ~1;
+	__m128i lo[3], hi[3];
+
+	for (int i = 0; i < pairs; i += 2) {
+		v210_unpack_avx2((const uint8_t *)(src + i * 8), lo, hi);
+		v210_store_uyvy_ssse3(lo, dst + i * 24);
+		v210_store_uyvy_ssse3(hi, dst + i * 24 + 24);
+	}
+
+	_mm256_zeroupper();
+	v210_line_to_uyvy_ssse3(src + pairs * 8, dst + pairs * 24, width - pairs * 12);
+}
+
+/* Two groups per vector, one per lane, compacted to 12 contiguous words */
+__attribute__((target("avx2")))
+static void v210_line_to_y10_avx2(const uint32_t * src, uint16_t * dst, int width)
+{
+	const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+	const __m256i store = _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, 0, 0);
+	int groups = (width > 0 ? width / 6 : 0) & ~1;
+
+	for (int g = 0; g < groups; g += 2) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(src + g * 4));
+		x = _mm256_mullo_epi16(_mm256_shuffle_epi8(x, _mm256_setr_epi8(V210_SHUF_Y10, V210_SHUF_Y10)),
+				       _mm256_setr_epi16(V210_MUL_Y10, V210_MUL_Y10));
+		x = _mm256_and_si256(_mm256_srli_epi16(x, 4), _mm256_set1_epi16(0x3ff));
+		_mm256_maskstore_epi32((int *)(dst + g * 6), store, _mm256_permutevar8x32_epi32(x, compact));
+	}
+
+	_mm256_zeroupper();
+	v210_line_to_y10_ssse3(src + groups * 4, dst + groups * 6, width - groups * 6);
+}
+
+/* Four pairs, pair n in lane n of each result */
+__attribute__((target("avx512f,avx512bw")))
+static inline void v210_unpack_avx512(const uint8_t *src, __m128i w[4][3])
+{
+	__m512i l0 = _mm512_loadu_si512(src);
+	__m512i l1 = _mm512_loadu_si512(src + 64);
+	__m512i in0 = _mm512_permutex2var_epi64(l0, _mm512_setr_epi64(0, 1, 4, 5, 8, 9, 12, 13), l1);
+	__m512i in1 = _mm512_permutex2var_epi64(l0, _mm512_setr_epi64(2, 3, 6, 7, 10, 11, 14, 15), l1);
+	__m512i x[3];
+
+	x[0] = _mm512_mullo_epi16(_mm512_shuffle_epi8(in0, _mm512_broadcast_i32x4(_mm_setr_epi8(V210_SHUF0))),
+				  _mm512_broadcast_i32x4(_mm_setr_epi16(V210_MUL0)));
+	x[1] = _mm512_mullo_epi16(_mm512_shuffle_epi8(_mm512_alignr_epi8(in1, in0, 8),
+						      _mm512_broadcast_i32x4(_mm_setr_epi8(V210_SHUF1))),
+				  _mm512_broadcast_i32x4(_mm_setr_epi16(V210_MUL1)));
+	x[2] = _mm512_mullo_epi16(_mm512_shuffle_epi8(in1, _mm512_broadcast_i32x4(_mm_setr_epi8(V210_SHUF2))),
+				  _mm512_broadcast_i32x4(_mm_setr_epi16(V210_MUL2)));
+
+	for (int i = 0; i < 3; i++) {
+		x[i] = _mm512_and_si512(_mm512_srli_epi16(x[i], 4), _mm512_set1_epi16(0x3ff));
+		w[0][i] = _mm512_extracti32x4_epi32(x[i], 0);
+		w[1][i] = _mm512_extracti32x4_epi32(x[i], 1);
+		w[2][i] = _mm512_extracti32x4_epi32(x[i], 2);
+		w[3][i] = _mm512_extracti32x4_epi32(x[i], 3);
+	}
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void v210_planar_unpack_avx512(const uint32_t * src, uint16_t * y, uint16_t * u, uint16_t * v, int width)
+{
+	int pairs = V210_PAIRS_PLANAR(width) & ~3;
+	__m128i w[4][3];
+
+	for (int i = 0; i < pairs; i += 4) {
+		v210_unpack_avx512((const uint8_t *)(src + i * 8), w);
+		for (int n = 0; n < 4; n++)
+			v210_store_planar_ssse3(w[n], y + (i + n) * 12, u + (i + n) * 6, v + (i + n) * 6);
+	}
+
+	v210_planar_unpack_avx2(src + pairs * 8, y + pairs * 12, u + pairs * 6, v + pairs * 6,
+				width - pairs * 12);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static int v210_line_to_nv20_avx512(const uint32_t * src, uint16_t * dst, int dstSizeBytes, int width)
+{
+	if (!src || !dst || !width)
+		return -1;
+
+	if (dstSizeBytes < (width * 6))
+		return -1;
+
+	int pairs = V210_PAIRS_PLANAR(width) & ~3;
+	uint16_t *uv = dst + width;
+	__m128i w[4][3];
+
+	for (int i = 0; i < pairs; i += 4) {
+		v210_unpack_avx512((const uint8_t *)(src + i * 8), w);
+		for (int n = 0; n < 4; n++)
+			v210_store_nv20_ssse3(w[n], dst + (i + n) * 12, uv + (i + n) * 12);
+	}
+
+	/* Up to three pairs remain, not worth another dispatch level */
+	_mm256_zeroupper();
+	v210_line_to_nv20(src + pairs * 8, dst + pairs * 12, uv + pairs * 12, width - pairs * 12);
+
+	return 0;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void v210_line_to_uyvy_avx512(const uint32_t * src, uint16_t * dst, int width)
+{
+	int pairs = V210_PAIRS_UYVY(width) & ~3;
+	__m128i w[4][3];
+
+	for (int i = 0; i < pairs; i += 4) {
+		v210_unpack_avx512((const uint8_t *)(src + i * 8), w);
+		for (int n = 0; n < 4; n++)
+			v210_store_uyvy_ssse3(w[n], dst + (i + n) * 24);
+	}
+
+	v210_line_to_uyvy_avx2(src + pairs * 8, dst + pairs * 24, width - pairs * 12);
+}
+/* Four groups per vector, compacted to 24 contiguous words */
+__attribute__((target("avx512f,avx512bw")))
+static void v210_line_to_y10_avx512(const uint32_t * src, uint16_t * dst, int width)
+{
+	const __m512i compact = _mm512_setr_epi32(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 3, 7, 11, 15);
+	int groups = (width > 0 ? width / 6 : 0) & ~3;
+
+	for (int g = 0; g < groups; g += 4) {
+		__m512i x = _mm512_loadu_si512(src + g * 4);
+		x = _mm512_mullo_epi16(_mm512_shuffle_epi8(x, _mm512_broadcast_i32x4(_mm_setr_epi8(V210_SHUF_Y10))),
+				       _mm512_broadcast_i32x4(_mm_setr_epi16(V210_MUL_Y10)));
+		x = _mm512_and_si512(_mm512_srli_epi16(x, 4), _mm512_set1_epi16(0x3ff));
+		_mm512_mask_storeu_epi16(dst + g * 6, 0xffffff, _mm512_permutexvar_epi32(compact, x));
+	}
+
+	v210_line_to_y10_avx2(src + groups * 4, dst + groups * 6, width - groups * 6);
+}
+#endif
+
+struct v210_unpack_ops_s
+{
+	const char *name;
+	unsigned int cpuFlags;
+	void (*planar_unpack)(const uint32_t * src, uint16_t * y, uint16_t * u, uint16_t * v, int width);
+	int (*line_to_nv20)(const uint32_t * src, uint16_t * dst, int dstSizeBytes, int width);
+	void (*line_to_uyvy)(const uint32_t * src, uint16_t * dst, int width);
+	void (*line_to_y10)(const uint32_t * src, uint16_t * dst, int width);
+};
+
+/* Best first, the C versions always qualify */
+static const struct v210_unpack_ops_s unpack_ops[] = {
+#if KLVANC_HAVE_X86_SIMD
+	{ "avx512", KLVANC_CPU_AVX512, v210_planar_unpack_avx512, v210_line_to_nv20_avx512, v210_line_to_uyvy_avx512,
+	  v210_line_to_y10_avx512 },
+	{ "avx2", KLVANC_CPU_AVX2, v210_planar_unpack_avx2, v210_line_to_nv20_avx2, v210_line_to_uyvy_avx2,
+	  v210_line_to_y10_avx2 },
+	{ "ssse3", KLVANC_CPU_SSSE3, v210_planar_unpack_ssse3, v210_line_to_nv20_ssse3, v210_line_to_uyvy_ssse3,
+	  v210_line_to_y10_ssse3 },
+#endif
+	{ "c", 0, klvanc_v210_planar_unpack_c, klvanc_v210_line_to_nv20_c, klvanc_v210_line_to_uyvy_c,
+	  klvanc_v210_line_to_y10_c },
+};
+
+static const struct v210_unpack_ops_s *unpack = &unpack_ops[(sizeof(unpack_ops) / sizeof(unpack_ops[0])) - 1];
+static pthread_once_t unpack_once = PTHREAD_ONCE_INIT;
+
+static void unpack_select(void)
+{
+	unsigned int flags = klvanc_cpu_flags();
+
+	for (unsigned int i = 0; i < sizeof(unpack_ops) / sizeof(unpack_ops[0]); i++) {
+		if ((unpack_ops[i].cpuFlags & flags) == unpack_ops[i].cpuFlags) {
+			unpack = &unpack_ops[i];
+			break;
+		}
+	}
+}
+
+void klvanc_v210_planar_unpack(const uint32_t * src, uint16_t * y, uint16_t * u, uint16_t * v, int width)
+{
+	pthread_once(&unpack_once, unpack_select);
+	unpack->planar_unpack(src, y, u, v, width);
+}
+
+int klvanc_v210_line_to_nv20(const uint32_t * src, uint16_t * dst, int dstSizeBytes, int width)
+{
+	pthread_once(&unpack_once, unpack_select);
+	return unpack->line_to_nv20(src, dst, dstSizeBytes, width);
+}
+
+void klvanc_v210_line_to_uyvy(const uint32_t * src, uint16_t * dst, int width)
+{
+	pthread_once(&unpack_once, unpack_select);
+	unpack->line_to_uyvy(src, dst, width);
+}
+
+void klvanc_v210_line_to_y10(const uint32_t * src, uint16_t * dst, int width)
+{
+	pthread_once(&unpack_once, unpack_select);
+	unpack->line_to_y10(src, dst, width);
+}
+
 static inline void put_le32(uint8_t **p, uint32_t d)
 {
 	uint32_t **x = (uint32_t **) p;
@@ -129,7 +596,7 @@ static inline void put_le32(uint8_t **p, uint32_t d)
 	(*p) += 4;
 }
 
-void klvanc_y10_to_v210(uint16_t *src, uint8_t *dst, int width)
+void klvanc_y10_to_v210_c(uint16_t *src, uint8_t *dst, int width)
 {
 	size_t len = width / 6;
 	size_t w;
@@ -154,7 +621,7 @@ void klvanc_y10_to_v210(uint16_t *src, uint8_t *dst, int width)
 		put_le32(&dst, src[w * 6 + 4] | (0x200 << 10)          | (0x040 << 20));
 }
 
-void klvanc_uyvy_to_v210(uint16_t *src, uint8_t *dst, int width)
+void klvanc_uyvy_to_v210_c(uint16_t *src, uint8_t *dst, int width)
 {
 	size_t len = width / 12;
 	size_t w;
@@ -224,3 +691,781 @@ void klvanc_uyvy_to_v210(uint16_t *src, uint8_t *dst, int width)
 			 (0x200 << 10) |
 			 (0x040 << 20));
 }
+
+/* SIMD packers, one 6 pixel group (16 bytes of v210) per 128 bit lane. The
+ * components of each output dword are gathered into three vectors of 32 bit
+ * lanes, blanking chroma for Y10 is ORed in, and the dword assembled with
+ * plain shifts. Inputs aren't masked, so out of range samples spill into the
+ * neighbouring component exactly as they do in the C versions.
+ */
+/* Whole groups of luma into v210 that already holds a line, chroma is left as it was */
+static void y10_merge_v210_c(const uint16_t *src, uint8_t *dst, int width)
+{
+	uint32_t *d = (uint32_t *)dst;
+
+	for (int w = 0; w < width / 6; w++, d += 4, src += 6) {
+		d[0] = (av_le2ne32(d[0]) & 0x3ff003ff) | (src[0] << 10);
+		d[1] = (av_le2ne32(d[1]) & 0x000ffc00) | src[1] | (src[2] << 20);
+		d[2] = (av_le2ne32(d[2]) & 0x3ff003ff) | (src[3] << 10);
+		d[3] = (av_le2ne32(d[3]) & 0x000ffc00) | src[4] | (src[5] << 20);
+	}
+}
+
+#if KLVANC_HAVE_X86_SIMD
+#define Z 0x80
+/* Y10: dwords Cb Y0 Cr, Y1 Cb Y2, Cr Y3 Cb, Y4 Cr Y5 with blanking chroma */
+#define Y10_SHUF_A Z, Z, Z, Z, 2, 3, Z, Z, Z, Z, Z, Z, 8, 9, Z, Z
+#define Y10_SHUF_B 0, 1, Z, Z, Z, Z, Z, Z, 6, 7, Z, Z, Z, Z, Z, Z
+#define Y10_SHUF_C Z, Z, Z, Z, 4, 5, Z, Z, Z, Z, Z, Z, 10, 11, Z, Z
+#define Y10_BLANK_A 0x200, 0, 0x200, 0
+#define Y10_BLANK_B 0, 0x200, 0, 0x200
+/* UYVY: words 0-7 in lo and 4-11 in hi, dword n takes words 3n, 3n + 1, 3n + 2 */
+#define UYVY_SHUF_A_LO 0, 1, Z, Z, 6, 7, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z
+#define UYVY_SHUF_A_HI Z, Z, Z, Z, Z, Z, Z, Z, 4, 5, Z, Z, 10, 11, Z, Z
+#define UYVY_SHUF_B_LO 2, 3, Z, Z, 8, 9, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z
+#define UYVY_SHUF_B_HI Z, Z, Z, Z, Z, Z, Z, Z, 6, 7, Z, Z, 12, 13, Z, Z
+#define UYVY_SHUF_C_LO 4, 5, Z, Z, 10, 11, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z
+#define UYVY_SHUF_C_HI Z, Z, Z, Z, Z, Z, Z, Z, 8, 9, Z, Z, 14, 15, Z, Z
+
+/* Exactly the six words of a Y10 group, no reading past the end of src */
+__attribute__((target("ssse3")))
+static inline __m128i y10_load_ssse3(const uint16_t *src)
+{
+	uint32_t last;
+
+	memcpy(&last, src + 4, sizeof(last));
+	return _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)src), _mm_cvtsi32_si128(last));
+}
+
+__attribute__((target("ssse3")))
+static void y10_to_v210_ssse3(uint16_t *src, uint8_t *dst, int width)
+{
+	int len = width / 6;
+	int w;
+
+	for (w = 0; w < len; w++) {
+		__m128i in = y10_load_ssse3(src + w * 6);
+		__m128i a = _mm_or_si128(_mm_shuffle_epi8(in, _mm_setr_epi8(Y10_SHUF_A)), _mm_setr_epi32(Y10_BLANK_A));
+		__m128i b = _mm_or_si128(_mm_shuffle_epi8(in, _mm_setr_epi8(Y10_SHUF_B)), _mm_setr_epi32(Y10_BLANK_B));
+		__m128i c = _mm_or_si128(_mm_shuffle_epi8(in, _mm_setr_epi8(Y10_SHUF_C)), _mm_setr_epi32(Y10_BLANK_A));
+
+		a = _mm_or_si128(a, _mm_or_si128(_mm_slli_epi32(b, 10), _mm_slli_epi32(c, 20)));
+		_mm_storeu_si128((__m128i *)(dst + w * 16), a);
+	}
+
+	klvanc_y10_to_v210_c(src + w * 6, dst + w * 16, width - w * 6);
+}
+
+#define Y10_KEEP 0x3ff003ff, 0x000ffc00, 0x3ff003ff, 0x000ffc00
+
+__attribute__((target("ssse3")))
+static void y10_merge_v210_ssse3(const uint16_t *src, uint8_t *dst, int width)
+{
+	int len = width / 6;
+
+	for (int w = 0; w < len; w++) {
+		__m128i in = y10_load_ssse3(src + w * 6);
+		__m128i a = _mm_shuffle_epi8(in, _mm_setr_epi8(Y10_SHUF_A));
+		__m128i b = _mm_shuffle_epi8(in, _mm_setr_epi8(Y10_SHUF_B));
+		__m128i c = _mm_shuffle_epi8(in, _mm_setr_epi8(Y10_SHUF_C));
+		__m128i d = _mm_and_si128(_mm_loadu_si128((const __m128i *)(dst + w * 16)), _mm_setr_epi32(Y10_KEEP));
+
+		a = _mm_or_si128(_mm_or_si128(a, d), _mm_or_si128(_mm_slli_epi32(b, 10), _mm_slli_epi32(c, 20)));
+		_mm_storeu_si128((__m128i *)(dst + w * 16), a);
+	}
+}
+
+__attribute__((target("ssse3")))
+static void uyvy_to_v210_ssse3(uint16_t *src, uint8_t *dst, int width)
+{
+	int len = width / 12;
+	int w;
+
+	for (w = 0; w < len; w++) {
+		__m128i lo = _mm_loadu_si128((const __m128i *)(src + w * 12));
+		__m128i hi = _mm_loadu_si128((const __m128i *)(src + w * 12 + 4));
+		__m128i a = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(UYVY_SHUF_A_LO)),
+					 _mm_shuffle_epi8(hi, _mm_setr_epi8(UYVY_SHUF_A_HI)));
+		__m128i b = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(UYVY_SHUF_B_LO)),
+					 _mm_shuffle_epi8(hi, _mm_setr_epi8(UYVY_SHUF_B_HI)));
+		__m128i c = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(UYVY_SHUF_C_LO)),
+					 _mm_shuffle_epi8(hi, _mm_setr_epi8(UYVY_SHUF_C_HI)));
+
+		a = _mm_or_si128(a, _mm_or_si128(_mm_slli_epi32(b, 10), _mm_slli_epi32(c, 20)));
+		_mm_storeu_si128((__m128i *)(dst + w * 16), a);
+	}
+
+	klvanc_uyvy_to_v210_c(src + w * 12, dst + w * 16, width - w * 12);
+}
+
+#define SHUF256(x) _mm256_setr_epi8(x, x)
+
+__attribute__((target("avx2")))
+static void y10_to_v210_avx2(uint16_t *src, uint8_t *dst, int width)
+{
+	int len = (width / 6) & ~1;
+	int w;
+
+	for (w = 0; w < len; w += 2) {
+		__m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(y10_load_ssse3(src + w * 6)),
+						     y10_load_ssse3(src + w * 6 + 6), 1);
+		__m256i a = _mm256_or_si256(_mm256_shuffle_epi8(in, SHUF256(Y10_SHUF_A)),
+					    _mm256_setr_epi32(Y10_BLANK_A, Y10_BLANK_A));
+		__m256i b = _mm256_or_si256(_mm256_shuffle_epi8(in, SHUF256(Y10_SHUF_B)),
+					    _mm256_setr_epi32(Y10_BLANK_B, Y10_BLANK_B));
+		__m256i c = _mm256_or_si256(_mm256_shuffle_epi8(in, SHUF256(Y10_SHUF_C)),
+					    _mm256_setr_epi32(Y10_BLANK_A, Y10_BLANK_A));
+
+		a = _mm256_or_si256(a, _mm256_or_si256(_mm256_slli_epi32(b, 10), _mm256_slli_epi32(c, 20)));
+		_mm256_storeu_si256((__m256i *)(dst + w * 16), a);
+	}
+
+	_mm256_zeroupper();
+	y10_to_v210_ssse3(src + w * 6, dst + w * 16, width - w * 6);
+}
+
+__attribute__((target("avx2")))
+static void y10_merge_v210_avx2(const uint16_t *src, uint8_t *dst, int width)
+{
+	int len = (width / 6) & ~1;
+	int w;
+
+	for (w = 0; w < len; w += 2) {
+		__m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(y10_load_ssse3(src + w * 6)),
+						     y10_load_ssse3(src + w * 6 + 6), 1);
+		__m256i a = _mm256_shuffle_epi8(in, SHUF256(Y10_SHUF_A));
+		__m256i b = _mm256_shuffle_epi8(in, SHUF256(Y10_SHUF_B));
+		__m256i c = _mm256_shuffle_epi8(in, SHUF256(Y10_SHUF_C));
+		__m256i d = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(dst + w * 16)),
+					     _mm256_setr_epi32(Y10_KEEP, Y10_KEEP));
+
+		a = _mm256_or_si256(_mm256_or_si256(a, d),
+				    _mm256_or_si256(_mm256_slli_epi32(b, 10), _mm256_slli_epi32(c, 20)));
+		_mm256_storeu_si256((__m256i *)(dst + w * 16), a);
+	}
+
+	_mm256_zeroupper();
+	y10_merge_v210_ssse3(src + w * 6, dst + w * 16, width - w * 6);
+}
+
+__attribute__((target("avx2")))
+static void uyvy_to_v210_avx2(uint16_t *src, uint8_t *dst, int width)
+{
+	int len = (width / 12) & ~1;
+	int w;
+
+	for (w = 0; w < len; w += 2) {
+		const uint16_t *s = src + w * 12;
+		__m256i lo = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)s)),
+						     _mm_loadu_si128((const __m128i *)(s + 12)), 1);
+		__m256i hi = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(s + 4))),
+						     _mm_loadu_si128((const __m128i *)(s + 16)), 1);
+		__m256i a = _mm256_or_si256(_mm256_shuffle_epi8(lo, SHUF256(UYVY_SHUF_A_LO)),
+					    _mm256_shuffle_epi8(hi, SHUF256(UYVY_SHUF_A_HI)));
+		__m256i b = _mm256_or_si256(_mm256_shuffle_epi8(lo, SHUF256(UYVY_SHUF_B_LO)),
+					    _mm256_shuffle_epi8(hi, SHUF256(UYVY_SHUF_B_HI)));
+		__m256i c = _mm256_or_si256(_mm256_shuffle_epi8(lo, SHUF256(UYVY_SHUF_C_LO)),
+					    _mm256_shuffle_epi8(hi, SHUF256(UYVY_SHUF_C_HI)));
+
+		a = _mm256_or_si256(a, _mm256_or_si256(_mm256_slli_epi32(b, 10), _mm256_slli_epi32(c, 20)));
+		_mm256_storeu_si256((__m256i *)(dst + w * 16), a);
+	}
+
+	_mm256_zeroupper();
+	uyvy_to_v210_ssse3(src + w * 12, dst + w * 16, width - w * 12);
+}
+#undef Z
+#endif
+
+struct v210_pack_ops_s
+{
+	const char *name;
+	unsigned int cpuFlags;
+	void (*y10_to_v210)(uint16_t *src, uint8_t *dst, int width);
+	void (*uyvy_to_v210)(uint16_t *src, uint8_t *dst, int width);
+	void (*y10_merge_v210)(const uint16_t *src, uint8_t *dst, int width);
+};
+
+static const struct v210_pack_ops_s pack_ops[] = {
+#if KLVANC_HAVE_X86_SIMD
+	{ "avx2", KLVANC_CPU_AVX2, y10_to_v210_avx2, uyvy_to_v210_avx2, y10_merge_v210_avx2 },
+	{ "ssse3", KLVANC_CPU_SSSE3, y10_to_v210_ssse3, uyvy_to_v210_ssse3, y10_merge_v210_ssse3 },
+#endif
+	{ "c", 0, klvanc_y10_to_v210_c, klvanc_uyvy_to_v210_c, y10_merge_v210_c },
+};
+
+static const struct v210_pack_ops_s *pack = &pack_ops[(sizeof(pack_ops) / sizeof(pack_ops[0])) - 1];
+static pthread_once_t pack_once = PTHREAD_ONCE_INIT;
+
+static void pack_select(void)
+{
+	unsigned int flags = klvanc_cpu_flags();
+
+	for (unsigned int i = 0; i < sizeof(pack_ops) / sizeof(pack_ops[0]); i++) {
+		if ((pack_ops[i].cpuFlags & flags) == pack_ops[i].cpuFlags) {
+			pack = &pack_ops[i];
+			break;
+		}
+	}
+}
+
+void klvanc_y10_to_v210(uint16_t *src, uint8_t *dst, int width)
+{
+	pthread_once(&pack_once, pack_select);
+	pack->y10_to_v210(src, dst, width);
+}
+
+void klvanc_uyvy_to_v210(uint16_t *src, uint8_t *dst, int width)
+{
+	pthread_once(&pack_once, pack_select);
+	pack->uyvy_to_v210(src, dst, width);
+}
+
+void klvanc_y10_merge_v210(const uint16_t *src, uint8_t *dst, int width)
+{
+	pthread_once(&pack_once, pack_select);
+	pack->y10_merge_v210(src, dst, width);
+}
+
+/* Native capture layouts, see klvanc_frame_parse_format(). The SSSE3 versions
+ * cover AVX2 and AVX-512 hosts too, these are memory bound and a single line
+ * of 8 or 16 bit samples doesn't gain from wider vectors.
+ */
+#define EXPAND8(b) ((uint16_t)(((b) << 2) | ((b) >> 6)))
+
+static void uyvy8_expand_c(const uint8_t *src, uint16_t *dst, int count)
+{
+	for (int i = 0; i < count; i++)
+		dst[i] = EXPAND8(src[i]);
+}
+
+static void uyvy8_split_c(const uint8_t *src, uint16_t *y, uint16_t *c, int width)
+{
+	for (int i = 0; i < width; i++) {
+		c[i] = EXPAND8(src[i * 2]);
+		y[i] = EXPAND8(src[i * 2 + 1]);
+	}
+}
+
+static void uyvy16_split_c(const uint16_t *src, uint16_t *y, uint16_t *c, int width)
+{
+	for (int i = 0; i < width; i++) {
+		c[i] = src[i * 2];
+		y[i] = src[i * 2 + 1];
+	}
+}
+
+static void p210_shift_c(const uint16_t *src, uint16_t *dst, int count)
+{
+	for (int i = 0; i < count; i++)
+		dst[i] = src[i] >> 6;
+}
+
+static void p210_merge_c(const uint16_t *y, const uint16_t *c, uint16_t *dst, int width)
+{
+	for (int i = 0; i < width; i++) {
+		dst[i * 2] = c[i] >> 6;
+		dst[i * 2 + 1] = y[i] >> 6;
+	}
+}
+
+#if KLVANC_HAVE_X86_SIMD
+__attribute__((target("ssse3")))
+static inline __m128i expand8_ssse3(__m128i x)
+{
+	return _mm_or_si128(_mm_slli_epi16(x, 2), _mm_srli_epi16(x, 6));
+}
+
+__attribute__((target("ssse3")))
+static void uyvy8_expand_ssse3(const uint8_t *src, uint16_t *dst, int count)
+{
+	int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dst + i), expand8_ssse3(_mm_unpacklo_epi8(x, _mm_setzero_si128())));
+		_mm_storeu_si128((__m128i *)(dst + i + 8), expand8_ssse3(_mm_unpackhi_epi8(x, _mm_setzero_si128())));
+	}
+
+	uyvy8_expand_c(src + i, dst + i, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void uyvy8_split_ssse3(const uint8_t *src, uint16_t *y, uint16_t *c, int width)
+{
+	int i = 0;
+
+	for (; i + 8 <= width; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i * 2));
+		_mm_storeu_si128((__m128i *)(c + i), expand8_ssse3(_mm_and_si128(x, _mm_set1_epi16(0xff))));
+		_mm_storeu_si128((__m128i *)(y + i), expand8_ssse3(_mm_srli_epi16(x, 8)));
+	}
+
+	uyvy8_split_c(src + i * 2, y + i, c + i, width - i);
+}
+
+__attribute__((target("ssse3")))
+static void uyvy16_split_ssse3(const uint16_t *src, uint16_t *y, uint16_t *c, int width)
+{
+	/* Even (chroma) words to the low half, odd (luma) words to the high half */
+	const __m128i shuf = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+	int i = 0;
+
+	for (; i + 8 <= width; i += 8) {
+		__m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + i * 2)), shuf);
+		__m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + i * 2 + 8)), shuf);
+		_mm_storeu_si128((__m128i *)(c + i), _mm_unpacklo_epi64(a, b));
+		_mm_storeu_si128((__m128i *)(y + i), _mm_unpackhi_epi64(a, b));
+	}
+
+	uyvy16_split_c(src + i * 2, y + i, c + i, width - i);
+}
+
+__attribute__((target("ssse3")))
+static void p210_shift_ssse3(const uint16_t *src, uint16_t *dst, int count)
+{
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(src + i)), 6));
+
+	p210_shift_c(src + i, dst + i, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void p210_merge_ssse3(const uint16_t *y, const uint16_t *c, uint16_t *dst, int width)
+{
+	int i = 0;
+
+	for (; i + 8 <= width; i += 8) {
+		__m128i ly = _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(y + i)), 6);
+		__m128i lc = _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(c + i)), 6);
+		_mm_storeu_si128((__m128i *)(dst + i * 2), _mm_unpacklo_epi16(lc, ly));
+		_mm_storeu_si128((__m128i *)(dst + i * 2 + 8), _mm_unpackhi_epi16(lc, ly));
+	}
+
+	p210_merge_c(y + i, c + i, dst + i * 2, width - i);
+}
+#endif
+
+struct format_ops_s
+{
+	const char *name;
+	unsigned int cpuFlags;
+	void (*uyvy8_expand)(const uint8_t *src, uint16_t *dst, int count);
+	void (*uyvy8_split)(const uint8_t *src, uint16_t *y, uint16_t *c, int width);
+	void (*uyvy16_split)(const uint16_t *src, uint16_t *y, uint16_t *c, int width);
+	void (*p210_shift)(const uint16_t *src, uint16_t *dst, int count);
+	void (*p210_merge)(const uint16_t *y, const uint16_t *c, uint16_t *dst, int width);
+};
+
+static const struct format_ops_s format_ops[] = {
+#if KLVANC_HAVE_X86_SIMD
+	{ "ssse3", KLVANC_CPU_SSSE3, uyvy8_expand_ssse3, uyvy8_split_ssse3, uyvy16_split_ssse3,
+	  p210_shift_ssse3, p210_merge_ssse3 },
+#endif
+	{ "c", 0, uyvy8_expand_c, uyvy8_split_c, uyvy16_split_c, p210_shift_c, p210_merge_c },
+};
+
+static const struct format_ops_s *format = &format_ops[(sizeof(format_ops) / sizeof(format_ops[0])) - 1];
+static pthread_once_t format_once = PTHREAD_ONCE_INIT;
+
+static void format_select(void)
+{
+	unsigned int flags = klvanc_cpu_flags();
+
+	for (unsigned int i = 0; i < sizeof(format_ops) / sizeof(format_ops[0]); i++) {
+		if ((format_ops[i].cpuFlags & flags) == format_ops[i].cpuFlags) {
+			format = &format_ops[i];
+			break;
+		}
+	}
+}
+
+void klvanc_uyvy8_expand(const uint8_t *src, uint16_t *dst, int count)
+{
+	pthread_once(&format_once, format_select);
+	format->uyvy8_expand(src, dst, count);
+}
+
+void klvanc_uyvy8_split(const uint8_t *src, uint16_t *y, uint16_t *c, int width)
+{
+	pthread_once(&format_once, format_select);
+	format->uyvy8_split(src, y, c, width);
+}
+
+void klvanc_uyvy16_split(const uint16_t *src, uint16_t *y, uint16_t *c, int width)
+{
+	pthread_once(&format_once, format_select);
+	format->uyvy16_split(src, y, c, width);
+}
+
+void klvanc_p210_shift(const uint16_t *src, uint16_t *dst, int count)
+{
+	pthread_once(&format_once, format_select);
+	format->p210_shift(src, dst, count);
+}
+
+void klvanc_p210_merge(const uint16_t *y, const uint16_t *c, uint16_t *dst, int width)
+{
+	pthread_once(&format_once, format_select);
+	format->p210_merge(y, c, dst, width);
+}
+
+/* Blank line pre-check. ANC always begins with an ADF, and its 3FF words can't
+ * appear in legal video, so a line holding no sample in the 3FC-3FF range can't
+ * hold a packet. A v210 line is the multiplexed Cb Y Cr Y sequence packed three
+ * samples to a dword, so the test needs no unpacking, just a streaming read.
+ */
+#define V210_FLAG(d, shift) ((((d) >> (shift)) & 0x3fc) == 0x3fc)
+
+static int v210_has_anc_c(const uint32_t *src, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples / 3; i++) {
+		if (V210_FLAG(src[i], 0) || V210_FLAG(src[i], 10) || V210_FLAG(src[i], 20))
+			return 1;
+	}
+
+	/* Trailing samples of a partial dword */
+	for (int k = 0; k < samples % 3; k++) {
+		if (V210_FLAG(src[i], k * 10))
+			return 1;
+	}
+
+	return 0;
+}
+
+static int words_have_anc_c(const uint16_t *words, int count, uint16_t mask)
+{
+	for (int i = 0; i < count; i++) {
+		if ((words[i] & mask) == mask)
+			return 1;
+	}
+	return 0;
+}
+
+#if KLVANC_HAVE_X86_SIMD
+__attribute__((target("sse2")))
+static int v210_has_anc_sse2(const uint32_t *src, int samples)
+{
+	const __m128i m0 = _mm_set1_epi32(0x3fc);
+	const __m128i m1 = _mm_set1_epi32(0x3fc << 10);
+	const __m128i m2 = _mm_set1_epi32(0x3fc << 20);
+	int i = 0;
+
+	for (; i + 4 <= samples / 3; i += 4) {
+		__m128i d = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i hit = _mm_cmpeq_epi32(_mm_and_si128(d, m0), m0);
+		hit = _mm_or_si128(hit, _mm_cmpeq_epi32(_mm_and_si128(d, m1), m1));
+		hit = _mm_or_si128(hit, _mm_cmpeq_epi32(_mm_and_si128(d, m2), m2));
+		if (_mm_movemask_epi8(hit))
+			return 1;
+	}
+
+	return v210_has_anc_c(src + i, samples - (i * 3));
+}
+
+__attribute__((target("sse2")))
+static int words_have_anc_sse2(const uint16_t *words, int count, uint16_t mask)
+{
+	const __m128i m = _mm_set1_epi16(mask);
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i w = _mm_loadu_si128((const __m128i *)(words + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(w, m), m)))
+			return 1;
+	}
+
+	return words_have_anc_c(words + i, count - i, mask);
+}
+
+__attribute__((target("avx2")))
+static int v210_has_anc_avx2(const uint32_t *src, int samples)
+{
+	const __m256i m0 = _mm256_set1_epi32(0x3fc);
+	const __m256i m1 = _mm256_set1_epi32(0x3fc << 10);
+	const __m256i m2 = _mm256_set1_epi32(0x3fc << 20);
+	int i = 0;
+
+	for (; i + 8 <= samples / 3; i += 8) {
+		__m256i d = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i hit = _mm256_cmpeq_epi32(_mm256_and_si256(d, m0), m0);
+		hit = _mm256_or_si256(hit, _mm256_cmpeq_epi32(_mm256_and_si256(d, m1), m1));
+		hit = _mm256_or_si256(hit, _mm256_cmpeq_epi32(_mm256_and_si256(d, m2), m2));
+		if (_mm256_movemask_epi8(hit))
+			return 1;
+	}
+
+	return v210_has_anc_sse2(src + i, samples - (i * 3));
+}
+
+__attribute__((target("avx2")))
+static int words_have_anc_avx2(const uint16_t *words, int count, uint16_t mask)
+{
+	const __m256i m = _mm256_set1_epi16(mask);
+	int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m256i w = _mm256_loadu_si256((const __m256i *)(words + i));
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(w, m), m)))
+			return 1;
+	}
+
+	return words_have_anc_sse2(words + i, count - i, mask);
+}
+#endif
+
+struct anc_check_ops_s
+{
+	const char *name;
+	unsigned int cpuFlags;
+	int (*v210_has_anc)(const uint32_t *src, int samples);
+	int (*words_have_anc)(const uint16_t *words, int count, uint16_t mask);
+};
+
+static const struct anc_check_ops_s check_ops[] = {
+#if KLVANC_HAVE_X86_SIMD
+	{ "avx2", KLVANC_CPU_AVX2, v210_has_anc_avx2, words_have_anc_avx2 },
+	{ "sse2", KLVANC_CPU_SSE2, v210_has_anc_sse2, words_have_anc_sse2 },
+#endif
+	{ "c", 0, v210_has_anc_c, words_have_anc_c },
+};
+
+static const struct anc_check_ops_s *check = &check_ops[(sizeof(check_ops) / sizeof(check_ops[0])) - 1];
+static pthread_once_t check_once = PTHREAD_ONCE_INIT;
+
+static void check_select(void)
+{
+	unsigned int flags = klvanc_cpu_flags();
+
+	for (unsigned int i = 0; i < sizeof(check_ops) / sizeof(check_ops[0]); i++) {
+		if ((check_ops[i].cpuFlags & flags) == check_ops[i].cpuFlags) {
+			check = &check_ops[i];
+			break;
+		}
+	}
+}
+
+int klvanc_v210_line_has_anc_c(const uint32_t *src, int width)
+{
+	return v210_has_anc_c(src, width * 2);
+}
+
+int klvanc_v210_line_has_anc(const uint32_t *src, int width)
+{
+	pthread_once(&check_once, check_select);
+	return check->v210_has_anc(src, width * 2);
+}
+
+int klvanc_words_have_anc(const uint16_t *words, int count, uint16_t mask)
+{
+	pthread_once(&check_once, check_select);
+	return check->words_have_anc(words, count, mask);
+}
+
+/* Run every width from a single pixel up to UHD through each kernel the CPU
+ * supports, the outputs (and the words just beyond them) must match the C
+ * versions exactly.
+ */
+#define SELFTEST_MAX_WIDTH 3840
+#define SELFTEST_GUARD 64
+
+static void selftest_reset(uint16_t *a, uint16_t *b, size_t words)
+{
+	memset(a, 0xa5, words * sizeof(uint16_t));
+	memset(b, 0xa5, words * sizeof(uint16_t));
+}
+
+static int selftest_compare(const char *name, const char *func, int width,
+			    const uint16_t *a, const uint16_t *b, size_t words)
+{
+	if (memcmp(a, b, words * sizeof(uint16_t)) == 0)
+		return 0;
+
+	for (size_t i = 0; i < words; i++) {
+		if (a[i] != b[i]) {
+			fprintf(stderr, "%s: %s width %d mismatch at word %zu, 0x%03x != 0x%03x\n",
+				func, name, width, i, a[i], b[i]);
+			break;
+		}
+	}
+	return -1;
+}
+
+int klvanc_pixels_selftest(void)
+{
+	size_t srcWords = ((SELFTEST_MAX_WIDTH + 5) / 6) * 4;
+	size_t dstWords = SELFTEST_MAX_WIDTH * 2 + SELFTEST_GUARD;
+	unsigned int flags = klvanc_cpu_flags();
+	uint32_t seed = 0x2a2a2a2a;
+	int ret = 0;
+
+	uint32_t *src = malloc(srcWords * sizeof(uint32_t));
+	uint16_t *ref = malloc(dstWords * 3 * sizeof(uint16_t));
+	uint16_t *out = malloc(dstWords * 3 * sizeof(uint16_t));
+	if (!src || !ref || !out) {
+		free(src);
+		free(ref);
+		free(out);
+		return -ENOMEM;
+	}
+
+	/* xorshift, including the two unused bits at the top of each dword */
+	for (size_t i = 0; i < srcWords; i++) {
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		src[i] = seed;
+	}
+
+	for (unsigned int n = 0; n < sizeof(unpack_ops) / sizeof(unpack_ops[0]) - 1; n++) {
+		const struct v210_unpack_ops_s *ops = &unpack_ops[n];
+		if ((ops->cpuFlags & flags) != ops->cpuFlags)
+			continue;
+
+		for (int width = 1; width <= SELFTEST_MAX_WIDTH && ret == 0; width++) {
+			size_t plane = dstWords;
+
+			selftest_reset(ref, out, dstWords * 3);
+			klvanc_v210_line_to_uyvy_c(src, ref, width);
+			ops->line_to_uyvy(src, out, width);
+			ret |= selftest_compare(ops->name, "line_to_uyvy", width, ref, out, dstWords);
+
+			selftest_reset(ref, out, dstWords * 3);
+			klvanc_v210_line_to_nv20_c(src, ref, dstWords * sizeof(uint16_t), width);
+			ops->line_to_nv20(src, out, dstWords * sizeof(uint16_t), width);
+			ret |= selftest_compare(ops->name, "line_to_nv20", width, ref, out, dstWords);
+
+			selftest_reset(ref, out, dstWords * 3);
+			klvanc_v210_line_to_y10_c(src, ref, width);
+			ops->line_to_y10(src, out, width);
+			ret |= selftest_compare(ops->name, "line_to_y10", width, ref, out, dstWords);
+
+			selftest_reset(ref, out, dstWords * 3);
+			klvanc_v210_planar_unpack_c(src, ref, ref + plane, ref + plane * 2, width);
+			ops->planar_unpack(src, out, out + plane, out + plane * 2, width);
+			ret |= selftest_compare(ops->name, "planar_unpack", width, ref, out, dstWords * 3);
+		}
+	}
+
+	/* Packers, from random 10 bit samples */
+	uint16_t *samples = (uint16_t *)src;
+	for (size_t i = 0; i < srcWords * 2; i++)
+		samples[i] &= 0x3ff;
+
+	for (unsigned int n = 0; n < sizeof(pack_ops) / sizeof(pack_ops[0]) - 1; n++) {
+		const struct v210_pack_ops_s *ops = &pack_ops[n];
+		if ((ops->cpuFlags & flags) != ops->cpuFlags)
+			continue;
+
+		for (int width = 1; width <= (int)srcWords * 2 && ret == 0; width++) {
+			size_t words = (((width + 5) / 6) * 16 + SELFTEST_GUARD) / sizeof(uint16_t);
+
+			selftest_reset(ref, out, words);
+			klvanc_y10_to_v210_c(samples, (uint8_t *)ref, width);
+			ops->y10_to_v210(samples, (uint8_t *)out, width);
+			ret |= selftest_compare(ops->name, "y10_to_v210", width, ref, out, words);
+
+			words = (((width + 11) / 12) * 16 + SELFTEST_GUARD) / sizeof(uint16_t);
+			selftest_reset(ref, out, words);
+			klvanc_uyvy_to_v210_c(samples, (uint8_t *)ref, width);
+			ops->uyvy_to_v210(samples, (uint8_t *)out, width);
+			ret |= selftest_compare(ops->name, "uyvy_to_v210", width, ref, out, words);
+
+			words = (((width + 5) / 6) * 16 + SELFTEST_GUARD) / sizeof(uint16_t);
+			selftest_reset(ref, out, words);
+			y10_merge_v210_c(samples, (uint8_t *)ref, width);
+			ops->y10_merge_v210(samples, (uint8_t *)out, width);
+			ret |= selftest_compare(ops->name, "y10_merge_v210", width, ref, out, words);
+		}
+	}
+
+	/* Native capture layouts, from the same random samples as 8 and 16 bit input */
+	const uint8_t *bytes = (const uint8_t *)src;
+	for (unsigned int n = 0; n < sizeof(format_ops) / sizeof(format_ops[0]) - 1; n++) {
+		const struct format_ops_s *ops = &format_ops[n];
+		const struct format_ops_s *c = &format_ops[(sizeof(format_ops) / sizeof(format_ops[0])) - 1];
+		if ((ops->cpuFlags & flags) != ops->cpuFlags)
+			continue;
+
+		for (int width = 1; width <= SELFTEST_MAX_WIDTH / 2 && ret == 0; width++) {
+			size_t words = width * 2 + SELFTEST_GUARD;
+
+			selftest_reset(ref, out, words);
+			c->uyvy8_expand(bytes, ref, width * 2);
+			ops->uyvy8_expand(bytes, out, width * 2);
+			ret |= selftest_compare(ops->name, "uyvy8_expand", width, ref, out, words);
+
+			selftest_reset(ref, out, words);
+			c->uyvy8_split(bytes, ref, ref + width, width);
+			ops->uyvy8_split(bytes, out, out + width, width);
+			ret |= selftest_compare(ops->name, "uyvy8_split", width, ref, out, words);
+
+			selftest_reset(ref, out, words);
+			c->uyvy16_split(samples, ref, ref + width, width);
+			ops->uyvy16_split(samples, out, out + width, width);
+			ret |= selftest_compare(ops->name, "uyvy16_split", width, ref, out, words);
+
+			selftest_reset(ref, out, words);
+			c->p210_shift(samples, ref, width);
+			ops->p210_shift(samples, out, width);
+			ret |= selftest_compare(ops->name, "p210_shift", width, ref, out, words);
+
+			selftest_reset(ref, out, words);
+			c->p210_merge(samples, samples + width, ref, width);
+			ops->p210_merge(samples, samples + width, out, width);
+			ret |= selftest_compare(ops->name, "p210_merge", width, ref, out, words);
+		}
+	}
+
+	/* Blank line pre-check, a blank v210 line with the unused top bits set, then a flag
+	 * planted at every sample position of a line, and one just beyond it.
+	 */
+	static const int checkWidths[] = { 1, 2, 3, 5, 6, 7, 11, 12, 13, 17, 18, 47, 48, 49, 720, 1920, 3840 };
+	uint16_t *words = ref;
+	for (unsigned int n = 0; n < sizeof(check_ops) / sizeof(check_ops[0]); n++) {
+		const struct anc_check_ops_s *ops = &check_ops[n];
+		if ((ops->cpuFlags & flags) != ops->cpuFlags)
+			continue;
+
+		for (unsigned int w = 0; w < sizeof(checkWidths) / sizeof(checkWidths[0]) && ret == 0; w++) {
+			int width = checkWidths[w];
+			int samples = width * 2;
+
+			for (size_t i = 0; i < srcWords; i++)
+				src[i] = 0xc0000000 | (0x200 << 20) | (0x040 << 10) | 0x200;
+			for (int i = 0; i < samples + 1; i++)
+				words[i] = (i & 1) ? 0x040 : 0x200;
+
+			for (int pos = -1; pos <= samples && ret == 0; pos++) {
+				int expect = pos >= 0 && pos < samples;
+				int dword = pos >= 0 && pos / 3 < (int)srcWords ? pos / 3 : -1;
+				uint32_t saved = dword >= 0 ? src[dword] : 0;
+				if (dword >= 0)
+					src[dword] |= 0x3fc << ((pos % 3) * 10);
+				if (pos >= 0)
+					words[pos] = 0x3fc;
+				if (ops->v210_has_anc(src, samples) != expect ||
+				    ops->words_have_anc(words, samples, 0x3fc) != expect ||
+				    ops->words_have_anc(words, samples, 0x3fc << 6) != 0) {
+					fprintf(stderr, "has_anc: %s width %d flag at %d not reported as %d\n",
+						ops->name, width, pos, expect);
+					ret = -1;
+				}
+				if (dword >= 0)
+					src[dword] = saved;
+				if (pos >= 0)
+					words[pos] = (pos & 1) ? 0x040 : 0x200;
+			}
+		}
+	}
+
+	free(src);
+	free(ref);
+	free(out);
+
+	return ret;
+}
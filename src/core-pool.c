@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2026 Kernel Labs Inc. All Rights Reserved
+ *
+ * Address: Kernel Labs Inc., PO Box 745, St James, NY. 11780
+ * Contact: sales@kernellabs.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <libklvanc/vanc.h>
+
+#include "core-private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Decoded packet structs only live from parse until the callback returns, then
+ * go back on their type's free list for the next packet. Once each list has
+ * grown to the most packets of that type ever in flight, decoding stops
+ * calling malloc and free altogether. Only ever touched from the thread
+ * delivering packets, so no locking.
+ */
+
+static void pool_drain(struct vanc_object_pool_s *pool)
+{
+	while (pool->freeList) {
+		void *p = pool->freeList;
+		pool->freeList = *(void **)p;
+		free(p);
+	}
+	pool->available = 0;
+}
+
+void *klvanc_pool_get(struct klvanc_context_s *ctx, enum klvanc_packet_type_e type, size_t size)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	struct vanc_object_pool_s *pool = &priv->pools[type];
+	void *p;
+
+	if (pool->freeList) {
+		p = pool->freeList;
+		pool->freeList = *(void **)p;
+		pool->available--;
+		memset(p, 0, size);
+	} else {
+		/* Every decoded struct starts with its header, so is always big
+		 * enough to hold the free list link.
+		 */
+		p = calloc(1, size);
+		if (!p)
+			return NULL;
+		pool->allocations++;
+	}
+
+	if (++pool->inUse > pool->highWater)
+		pool->highWater = pool->inUse;
+
+	return p;
+}
+
+void klvanc_pool_put(struct klvanc_context_s *ctx, enum klvanc_packet_type_e type, void *p)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	struct vanc_object_pool_s *pool = &priv->pools[type];
+
+	if (!p)
+		return;
+
+	*(void **)p = pool->freeList;
+	pool->freeList = p;
+	pool->available++;
+	pool->inUse--;
+}
+
+void klvanc_pools_free(struct klvanc_context_s *ctx)
+{
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+
+	for (int i = 0; i < KLVANC_POOL_TYPES; i++)
+		pool_drain(&priv->pools[i]);
+}
+
+int klvanc_pool_stats(struct klvanc_context_s *ctx, enum klvanc_packet_type_e type,
+		      struct klvanc_pool_stats_s *stats)
+{
+	VALIDATE(ctx);
+	VALIDATE(stats);
+	if ((unsigned int)type >= KLVANC_POOL_TYPES)
+		return -EINVAL;
+
+	struct vanc_object_pool_s *pool = &getPrivate(ctx)->pools[type];
+	stats->inUse = pool->inUse;
+	stats->available = pool->available;
+	stats->highWater = pool->highWater;
+	stats->allocations = pool->allocations;
+
+	return KLAPI_OK;
+}
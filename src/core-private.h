@@ -33,10 +33,144 @@
 #include "klbitstream_readwriter.h"
 
 #define getPrivate(ctx) ((struct vanc_context_private_s *)ctx->priv)
+
+/* A decoder for a single DID/SDID pair. Builtin decoders fire the matching
+ * klvanc_callbacks_s entry themselves from parse, application registered
+ * decoders (see klvanc_register_decoder()) are given cb, called by the core.
+ */
+struct vanc_decoder_s
+{
+	enum klvanc_packet_type_e type;
+	int (*parse)(struct klvanc_context_s *, struct klvanc_packet_header_s *, void **);
+	int (*dump)(struct klvanc_context_s *, void *);
+	void (*free)(void *);
+	void (*release)(struct klvanc_context_s *, enum klvanc_packet_type_e, void *);	/* Builtins, back to the pool */
+	int (*cb)(void *, struct klvanc_context_s *, struct klvanc_packet_header_s *, void *);
+};
+
+/* Free list of decoded packet structs for a single packet type, see core-pool.c */
+struct vanc_object_pool_s
+{
+	void *freeList;		/* Linked through the first word of each object */
+	unsigned int inUse;
+	unsigned int available;
+	unsigned int highWater;
+	uint64_t allocations;
+};
+#define KLVANC_POOL_TYPES (VANC_TYPE_SMPTE_S2108_1 + 1)
+
+struct vanc_frame_pool_s;
+struct vanc_memo_s;
+struct vanc_memo_entry_s;
+struct vanc_render_line_s;
+struct vanc_cache_s;
+
+/* Runtime statistics, see klvanc_context_enable_stats() and core-stats.c */
+struct vanc_stats_did_s
+{
+	uint64_t packets;
+	uint64_t decodeFailures;
+	uint64_t checksumFailures;
+};
+
+struct vanc_stats_s
+{
+	int enabled;
+	uint64_t packets;
+	uint64_t packetsUnchanged;
+	uint64_t decodeFailures;
+	uint64_t checksumFailures;
+	uint64_t linesScanned;
+	uint64_t linesBlank;
+	uint64_t bytesScanned;
+	uint64_t allocations;
+	uint64_t framesGenerated;
+	uint64_t linesGenerated;
+	uint64_t linesReused;
+	uint64_t poolAllocations;	/* Pool allocations as of the last reset */
+	uint64_t deliverNs;		/* Running totals, so scan and decode time can */
+	uint64_t callbackNs;		/* exclude the work nested within them */
+	struct klvanc_histogram_s scan;
+	struct klvanc_histogram_s decode;
+	struct klvanc_histogram_s callback;
+	struct klvanc_histogram_s generate;
+	uint64_t lines[KLVANC_SUBSCRIBE_MAX_LINES];
+	struct vanc_stats_did_s *dids[256];	/* Rows allocated per DID, indexed by sdid */
+};
+
+/* Library state which applications have no business looking at */
+struct vanc_context_private_s
+{
+	/* Decoder dispatch, indexed by [did][sdid]. A DID row is only allocated
+	 * once a decoder is registered against it, NULL rows have no decoders.
+	 */
+	struct vanc_decoder_s *decoders[256];
+
+	/* Subscription filters, see klvanc_context_subscribe(). While a filter is
+	 * disabled every packet, or every line, is processed.
+	 */
+	int filterPackets;
+	uint8_t subscribedPackets[0x10000 / 8];	/* bit per (did << 8 | sdid) */
+	int filterLines;
+	uint8_t subscribedLines[KLVANC_SUBSCRIBE_MAX_LINES / 8];
+
+	/* Whole frame parsing, see klvanc_frame_parse(). The unpacked words of every
+	 * line are kept until the end of frame callback, the headers collected for
+	 * it point into them.
+	 */
+	uint16_t *frameWords;
+	size_t frameWordsAlloc;
+	int frameCollect;
+	struct klvanc_packet_header_s *framePackets;
+	unsigned int framePacketCount;
+	unsigned int framePacketAlloc;
+	uint64_t frameId;
+
+	/* Worker threads for klvanc_frame_parse(), see klvanc_context_enable_threads() */
+	struct vanc_frame_pool_s *pool;
+
+	/* Memoized decode, see klvanc_context_enable_memo() */
+	struct vanc_memo_s *memo;
+
+	/* Last rendering per line number, see klvanc_context_enable_render_cache() */
+	struct vanc_render_line_s **render;
+
+	/* DID/SDID pairs and lines seen, see klvanc_context_enable_cache() */
+	struct vanc_cache_s *cache;
+
+	/* Decoded packet structs, indexed by packet type */
+	struct vanc_object_pool_s pools[KLVANC_POOL_TYPES];
+
+	struct vanc_stats_s stats;
+};
+
+static inline int klvanc_packet_subscribed(struct vanc_context_private_s *priv, uint16_t did, uint16_t sdid)
+{
+	unsigned int idx = ((did & 0xff) << 8) | (sdid & 0xff);
+	return !priv->filterPackets || (priv->subscribedPackets[idx >> 3] & (1 << (idx & 7)));
+}
+
+static inline int klvanc_line_subscribed(struct vanc_context_private_s *priv, unsigned int lineNr)
+{
+	if (!priv->filterLines)
+		return 1;
+	if (lineNr >= KLVANC_SUBSCRIBE_MAX_LINES)
+		return 0;
+	return priv->subscribedLines[lineNr >> 3] & (1 << (lineNr & 7));
+}
 #define sanitizeWord(word) ((word) & 0xff)
 
 #define KLAPI_OK 0
 
+/* SIMD implementations are only built for x86 with a GCC compatible compiler,
+ * everywhere else the C versions are used.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define KLVANC_HAVE_X86_SIMD 1
+#else
+#define KLVANC_HAVE_X86_SIMD 0
+#endif
+
 #define VALIDATE(ctx) \
  if (!ctx) return -EINVAL;
 
@@ -60,6 +194,7 @@ int dump_SCTE_104(struct klvanc_context_s *ctx, void *p);
 int parse_SCTE_104(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr,
 		   void **pp);
 void cleanup_SCTE_104(struct klvanc_context_s *ctx);
+void release_SCTE_104(struct klvanc_context_s *ctx, enum klvanc_packet_type_e type, void *p);
 
 /* core-packet-kl_u64le_counter.c */
 int dump_KL_U64LE_COUNTER(struct klvanc_context_s *ctx, void *p);
@@ -69,6 +204,44 @@ int parse_KL_U64LE_COUNTER(struct klvanc_context_s *ctx,
 void klvanc_dump_packet_console(struct klvanc_context_s *ctx,
 				struct klvanc_packet_header_s *hdr);
 
+/* core-packets.c */
+int  klvanc_decoders_alloc(struct klvanc_context_s *ctx);
+void klvanc_decoders_free(struct klvanc_context_s *ctx);
+struct vanc_decoder_s *klvanc_decoder_slot(struct klvanc_context_s *ctx, uint8_t did, uint8_t sdid);
+
+/* Header view and checksum of the packet at arr, where len words are available.
+ * Thread safe, touches nothing but hdr. horizontalOffset and lineNr are left
+ * for the caller. Returns < 0 if arr doesn't hold a valid packet.
+ */
+int klvanc_packet_view(const unsigned short *arr, unsigned int len, struct klvanc_packet_header_s *hdr);
+
+/* Account for, cache, decode and trigger every callback for a packet view. */
+void klvanc_packet_deliver(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr);
+
+/* klvanc_packet_view() plus klvanc_packet_deliver(). Returns the number of words the
+ * packet occupies, or < 0 if arr doesn't hold a valid packet.
+ */
+int klvanc_packet_process(struct klvanc_context_s *ctx, unsigned int lineNr, unsigned int horizontalOffset,
+			  const unsigned short *arr, unsigned int len);
+
+/* klvanc_packet_parse() without the argument checks, line filter or scan statistics */
+int klvanc_packet_scan(struct klvanc_context_s *ctx, unsigned int lineNr, const unsigned short *arr, unsigned int len);
+
+static inline const struct vanc_decoder_s *klvanc_decoder_lookup(struct klvanc_context_s *ctx,
+								 uint16_t did, uint16_t sdid)
+{
+	const struct vanc_decoder_s *row = getPrivate(ctx)->decoders[did & 0xff];
+	if (row && row[sdid & 0xff].parse)
+		return &row[sdid & 0xff];
+	return NULL;
+}
+
+/* Allocate a materialized header with room for words of raw and payload data.
+ * Scalar fields are taken from src, both lengths start at zero.
+ */
+int klvanc_packet_alloc(struct klvanc_packet_header_s **dst,
+			const struct klvanc_packet_header_s *src, unsigned int words);
+
 /* core-packet-sdp.c */
 int dump_SDP(struct klvanc_context_s *ctx, void *p);
 int parse_SDP(struct klvanc_context_s *ctx,
@@ -85,6 +258,105 @@ int parse_SMPTE_2108_1(struct klvanc_context_s *ctx, struct klvanc_packet_header
 		       void **pp);
 
 
+/* core-pool.c */
+void *klvanc_pool_get(struct klvanc_context_s *ctx, enum klvanc_packet_type_e type, size_t size);
+void klvanc_pool_put(struct klvanc_context_s *ctx, enum klvanc_packet_type_e type, void *p);
+void klvanc_pools_free(struct klvanc_context_s *ctx);
+
+/* core-memo.c */
+/* 64 bit XXH64 of len bytes */
+uint64_t klvanc_hash64(const void *data, size_t len, uint64_t seed);
+
+/* If hdr is identical to the last packet at its line and horizontal offset, fire its
+ * callbacks from the memo and return 1. Otherwise return 0, and if the packet's
+ * position has an entry, set *entry for klvanc_memo_store() to take the newly
+ * decoded struct.
+ */
+int  klvanc_memo_deliver(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr,
+			 const struct vanc_decoder_s *dec, struct vanc_memo_entry_s **entry);
+void klvanc_memo_store(struct vanc_memo_entry_s *e, const struct vanc_decoder_s *dec, void *decoded);
+void klvanc_memo_free(struct klvanc_context_s *ctx);
+
+/* core-checksum.c */
+/* Checksum word (b9 included) of the wordCount words starting at the DID, and in the same
+ * pass whether every one of them carries correct b8/b9 parity. parityValid may be NULL.
+ */
+uint16_t klvanc_checksum_parity(const uint16_t *words, unsigned int wordCount, int *parityValid);
+
+/* Replace b8/b9 of each word with the parity of its low 8 bits */
+void klvanc_parity_generate(uint16_t *words, unsigned int wordCount);
+
+/* core-stats.c */
+uint64_t klvanc_stats_clock(void);
+void klvanc_stats_scanned(struct klvanc_context_s *ctx, uint64_t ns, uint64_t bytes);
+void klvanc_stats_scan(struct klvanc_context_s *ctx, uint64_t begin, uint64_t deliverNs, uint64_t bytes);
+void klvanc_stats_decode(struct klvanc_context_s *ctx, uint64_t begin, uint64_t callbackNs);
+void klvanc_stats_callback(struct klvanc_context_s *ctx, uint64_t begin);
+void klvanc_stats_generate(struct klvanc_context_s *ctx, uint64_t begin, unsigned int lines,
+			   unsigned int reused);
+void klvanc_stats_packet(struct klvanc_context_s *ctx, const struct klvanc_packet_header_s *hdr,
+			 int decodeFailed, uint64_t begin);
+void klvanc_stats_free(struct klvanc_context_s *ctx);
+
+/* Timestamp to hand the klvanc_stats_ functions, or 0 if statistics are off */
+static inline uint64_t klvanc_stats_begin(struct klvanc_context_s *ctx)
+{
+	return getPrivate(ctx)->stats.enabled ? klvanc_stats_clock() : 0;
+}
+
+/* Call into the application, timing it if statistics are on */
+#define KLVANC_CALLBACK(ctx, call) do { \
+	uint64_t __begin = klvanc_stats_begin(ctx); \
+	call; \
+	if (__begin) \
+		klvanc_stats_callback(ctx, __begin); \
+} while (0)
+
+/* core-frame.c */
+int  klvanc_frame_collect(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr);
+void klvanc_frame_free(struct klvanc_context_s *ctx);
+
+/* Run task(arg, n) for every n below count on the klvanc_context_enable_threads() workers,
+ * the calling thread included, and return once all are done. -EINVAL without workers.
+ */
+int  klvanc_frame_pool_for(struct klvanc_context_s *ctx, unsigned int count,
+			   void (*task)(void *arg, unsigned int n), void *arg);
+
+/* core-lines.c */
+void klvanc_render_cache_free(struct klvanc_context_s *ctx);
+
+/* core-cpu.c */
+#define KLVANC_CPU_SSE2   (1 << 0)
+#define KLVANC_CPU_SSSE3  (1 << 1)
+#define KLVANC_CPU_AVX2   (1 << 2)
+#define KLVANC_CPU_AVX512 (1 << 3) /* AVX-512 F + BW */
+unsigned int klvanc_cpu_flags(void);
+
+/* core-pixels.c */
+/* Native capture layouts to 10 bit words, for klvanc_frame_parse_format(). 8 bit samples are
+ * widened as video (b << 2 | b >> 6), so the ADF 00/FF/FF becomes 000/3FF/3FF. The split
+ * routines separate the luma and chroma of width pixels, the others handle count samples.
+ */
+void klvanc_uyvy8_expand(const uint8_t *src, uint16_t *dst, int count);
+void klvanc_uyvy8_split(const uint8_t *src, uint16_t *y, uint16_t *c, int width);
+void klvanc_uyvy16_split(const uint16_t *src, uint16_t *y, uint16_t *c, int width);
+void klvanc_p210_shift(const uint16_t *src, uint16_t *dst, int count);
+void klvanc_p210_merge(const uint16_t *y, const uint16_t *c, uint16_t *dst, int width);
+
+/* Luma of the whole groups in width pixels into a v210 line, keeping its chroma as it was.
+ * Used when generating into a caller's frame.
+ */
+void klvanc_y10_merge_v210(const uint16_t *src, uint8_t *dst, int width);
+
+/* As per klvanc_v210_line_has_anc(), for count words whose ADF words have every bit of mask set */
+int klvanc_words_have_anc(const uint16_t *words, int count, uint16_t mask);
+
+/* core-adf.c */
+/* Return the first word index in [start, end) which looks like the start of an ADF,
+ * or end if there is none. words[end + 1] must be readable.
+ */
+unsigned int klvanc_adf_find(const uint16_t *words, unsigned int start, unsigned int end);
+
 /* We don't expect anything outside of the VANC framework to need toascii
  * call these, so we'll keep them private / internal calls.
  */
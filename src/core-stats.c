@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2026 Kernel Labs Inc. All Rights Reserved
+ *
+ * Address: Kernel Labs Inc., PO Box 745, St James, NY. 11780
+ * Contact: sales@kernellabs.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <libklvanc/vanc.h>
+
+#include "core-private.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Counters are only written by the thread delivering packets. Frame parsing
+ * workers time and count their lines privately, the delivering thread folds
+ * those in as it walks the lines, so nothing here needs atomics or locks.
+ */
+
+uint64_t klvanc_stats_clock(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/* Values below 4ns get a bucket each, above that every power of two is split in four */
+static unsigned int histogram_bucket(uint64_t ns)
+{
+	if (ns < 4)
+		return ns;
+
+	unsigned int e = 63 - __builtin_clzll(ns);
+	unsigned int idx = ((e - 1) << 2) | ((ns >> (e - 2)) & 3);
+	if (idx >= KLVANC_HISTOGRAM_BUCKETS)
+		idx = KLVANC_HISTOGRAM_BUCKETS - 1;
+	return idx;
+}
+
+static uint64_t histogram_bucket_max(unsigned int idx)
+{
+	if (idx < 4)
+		return idx;
+
+	unsigned int e = (idx >> 2) + 1;
+	return (((uint64_t)4 + (idx & 3)) << (e - 2)) + ((uint64_t)1 << (e - 2)) - 1;
+}
+
+static void histogram_record(struct klvanc_histogram_s *h, uint64_t ns)
+{
+	if (h->count == 0 || ns < h->minNs)
+		h->minNs = ns;
+	if (ns > h->maxNs)
+		h->maxNs = ns;
+	h->count++;
+	h->totalNs += ns;
+	h->buckets[histogram_bucket(ns)]++;
+}
+
+uint64_t klvanc_histogram_percentile(const struct klvanc_histogram_s *h, double percentile)
+{
+	if (!h || h->count == 0)
+		return 0;
+
+	uint64_t target = (uint64_t)((percentile / 100.0) * h->count);
+	if (target < 1)
+		target = 1;
+
+	uint64_t seen = 0;
+	for (unsigned int i = 0; i < KLVANC_HISTOGRAM_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= target) {
+			uint64_t ns = histogram_bucket_max(i);
+			return ns < h->maxNs ? ns : h->maxNs;
+		}
+	}
+
+	return h->maxNs;
+}
+
+void klvanc_stats_scanned(struct klvanc_context_s *ctx, uint64_t ns, uint64_t bytes)
+{
+	struct vanc_stats_s *st = &getPrivate(ctx)->stats;
+
+	st->linesScanned++;
+	st->bytesScanned += bytes;
+	histogram_record(&st->scan, ns);
+}
+
+void klvanc_stats_scan(struct klvanc_context_s *ctx, uint64_t begin, uint64_t deliverNs, uint64_t bytes)
+{
+	struct vanc_stats_s *st = &getPrivate(ctx)->stats;
+
+	/* Serial scanning delivers packets as it finds them, that time is accounted elsewhere */
+	uint64_t ns = klvanc_stats_clock() - begin;
+	uint64_t delivering = st->deliverNs - deliverNs;
+	klvanc_stats_scanned(ctx, ns > delivering ? ns - delivering : 0, bytes);
+}
+
+void klvanc_stats_decode(struct klvanc_context_s *ctx, uint64_t begin, uint64_t callbackNs)
+{
+	struct vanc_stats_s *st = &getPrivate(ctx)->stats;
+
+	/* Builtin decoders trigger their callback from within parse, don't charge it to decode */
+	uint64_t ns = klvanc_stats_clock() - begin;
+	uint64_t calling = st->callbackNs - callbackNs;
+	histogram_record(&st->decode, ns > calling ? ns - calling : 0);
+}
+
+void klvanc_stats_callback(struct klvanc_context_s *ctx, uint64_t begin)
+{
+	struct vanc_stats_s *st = &getPrivate(ctx)->stats;
+
+	uint64_t ns = klvanc_stats_clock() - begin;
+	st->callbackNs += ns;
+	histogram_record(&st->callback, ns);
+}
+
+void klvanc_stats_generate(struct klvanc_context_s *ctx, uint64_t begin, unsigned int lines,
+			   unsigned int reused)
+{
+	struct vanc_stats_s *st = &getPrivate(ctx)->stats;
+
+	st->framesGenerated++;
+	st->linesGenerated += lines;
+	st->linesReused += reused;
+	histogram_record(&st->generate, klvanc_stats_clock() - begin);
+}
+
+void klvanc_stats_packet(struct klvanc_context_s *ctx, const struct klvanc_packet_header_s *hdr,
+			 int decodeFailed, uint64_t begin)
+{
+	struct vanc_stats_s *st = &getPrivate(ctx)->stats;
+	uint8_t did = hdr->did;
+
+	st->deliverNs += klvanc_stats_clock() - begin;
+
+	st->packets++;
+	if (hdr->lineNr < KLVANC_SUBSCRIBE_MAX_LINES)
+		st->lines[hdr->lineNr]++;
+
+	/* Rows are only allocated for DIDs actually seen. Published with release
+	 * semantics, klvanc_context_get_stats() may be walking them from another thread.
+	 */
+	struct vanc_stats_did_s *row = st->dids[did];
+	if (!row) {
+		row = calloc(256, sizeof(*row));
+		if (!row)
+			return;
+		st->allocations++;
+		__atomic_store_n(&st->dids[did], row, __ATOMIC_RELEASE);
+	}
+
+	struct vanc_stats_did_s *e = &row[hdr->dbnsdid & 0xff];
+	e->packets++;
+	if (!hdr->checksumValid) {
+		e->checksumFailures++;
+		st->checksumFailures++;
+	}
+	if (decodeFailed) {
+		e->decodeFailures++;
+		st->decodeFailures++;
+	}
+}
+
+static uint64_t pool_allocations(struct vanc_context_private_s *priv)
+{
+	uint64_t n = 0;
+	for (int i = 0; i < KLVANC_POOL_TYPES; i++)
+		n += priv->pools[i].allocations;
+	return n;
+}
+
+int klvanc_context_enable_stats(struct klvanc_context_s *ctx)
+{
+	VALIDATE(ctx);
+
+	getPrivate(ctx)->stats.enabled = 1;
+
+	return KLAPI_OK;
+}
+
+void klvanc_context_stats_reset(struct klvanc_context_s *ctx)
+{
+	if (!ctx)
+		return;
+
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	struct vanc_stats_s *st = &priv->stats;
+
+	for (int i = 0; i < 256; i++) {
+		if (st->dids[i])
+			memset(st->dids[i], 0, 256 * sizeof(struct vanc_stats_did_s));
+	}
+
+	st->packets = 0;
+	st->packetsUnchanged = 0;
+	st->decodeFailures = 0;
+	st->checksumFailures = 0;
+	st->linesScanned = 0;
+	st->linesBlank = 0;
+	st->bytesScanned = 0;
+	st->allocations = 0;
+	st->framesGenerated = 0;
+	st->linesGenerated = 0;
+	st->linesReused = 0;
+	st->poolAllocations = pool_allocations(priv);
+	memset(&st->scan, 0, sizeof(st->scan));
+	memset(&st->decode, 0, sizeof(st->decode));
+	memset(&st->callback, 0, sizeof(st->callback));
+	memset(&st->generate, 0, sizeof(st->generate));
+	memset(st->lines, 0, sizeof(st->lines));
+}
+
+int klvanc_context_get_stats(struct klvanc_context_s *ctx, struct klvanc_stats_s **stats)
+{
+	VALIDATE(ctx);
+	VALIDATE(stats);
+
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	struct vanc_stats_s *st = &priv->stats;
+
+	/* Size for every DID/SDID seen so far, any that show up mid copy are left out */
+	unsigned int count = 0;
+	for (int d = 0; d < 256; d++) {
+		const struct vanc_stats_did_s *row = __atomic_load_n(&st->dids[d], __ATOMIC_ACQUIRE);
+		if (!row)
+			continue;
+		for (int s = 0; s < 256; s++) {
+			if (row[s].packets)
+				count++;
+		}
+	}
+
+	struct klvanc_stats_s *p = malloc(sizeof(*p) + (count * sizeof(struct klvanc_stats_did_s)));
+	if (!p)
+		return -ENOMEM;
+
+	p->packets = st->packets;
+	p->packetsUnchanged = st->packetsUnchanged;
+	p->decodeFailures = st->decodeFailures;
+	p->checksumFailures = st->checksumFailures;
+	p->linesScanned = st->linesScanned;
+	p->linesBlank = st->linesBlank;
+	p->bytesScanned = st->bytesScanned;
+	p->allocations = st->allocations + pool_allocations(priv) - st->poolAllocations;
+	p->framesGenerated = st->framesGenerated;
+	p->linesGenerated = st->linesGenerated;
+	p->linesReused = st->linesReused;
+	p->scan = st->scan;
+	p->decode = st->decode;
+	p->callback = st->callback;
+	p->generate = st->generate;
+	memcpy(p->lines, st->lines, sizeof(p->lines));
+
+	p->dids = (struct klvanc_stats_did_s *)(p + 1);
+	p->didCount = 0;
+	for (int d = 0; d < 256; d++) {
+		const struct vanc_stats_did_s *row = __atomic_load_n(&st->dids[d], __ATOMIC_ACQUIRE);
+		if (!row)
+			continue;
+		for (int s = 0; s < 256 && p->didCount < count; s++) {
+			if (!row[s].packets)
+				continue;
+			struct klvanc_stats_did_s *e = &p->dids[p->didCount++];
+			e->did = d;
+			e->sdid = s;
+			e->packets = row[s].packets;
+			e->decodeFailures = row[s].decodeFailures;
+			e->checksumFailures = row[s].checksumFailures;
+		}
+	}
+
+	*stats = p;
+	return KLAPI_OK;
+}
+
+void klvanc_context_stats_free(struct klvanc_stats_s *stats)
+{
+	free(stats);
+}
+
+void klvanc_stats_free(struct klvanc_context_s *ctx)
+{
+	struct vanc_stats_s *st = &getPrivate(ctx)->stats;
+
+	for (int i = 0; i < 256; i++) {
+		free(st->dids[i]);
+		st->dids[i] = NULL;
+	}
+}
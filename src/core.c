@@ -53,6 +53,18 @@ int klvanc_context_create(struct klvanc_context_s **ctx)
 	if (!p)
 		return -ENOMEM;
 
+	p->priv = calloc(1, sizeof(struct vanc_context_private_s));
+	if (!p->priv) {
+		free(p);
+		return -ENOMEM;
+	}
+
+	if (klvanc_decoders_alloc(p) < 0) {
+		free(p->priv);
+		free(p);
+		return -ENOMEM;
+	}
+
 	/* If we fail to parse a vanc message, don't report more than one of those per second. */
 	klrestricted_code_path_block_initialize(&p->rcp_failedToDecode, 1, 1, 60 * 1000);
 
@@ -73,6 +85,14 @@ int klvanc_context_destroy(struct klvanc_context_s *ctx)
 
 	cleanup_SCTE_104(ctx);
 
+	klvanc_memo_free(ctx);
+	klvanc_render_cache_free(ctx);
+	klvanc_decoders_free(ctx);
+	klvanc_frame_free(ctx);
+	klvanc_pools_free(ctx);
+	klvanc_stats_free(ctx);
+	free(ctx->priv);
+
 	memset(ctx, 0, sizeof(*ctx));
 	free(ctx);
 
@@ -89,3 +109,47 @@ int klvanc_context_enable_cache(struct klvanc_context_s *ctx)
 	return 0;
 }
 
+
+int klvanc_context_subscribe(struct klvanc_context_s *ctx, uint8_t did, int sdid)
+{
+	VALIDATE(ctx);
+	if (sdid > 0xff)
+		return -EINVAL;
+
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	for (int s = 0; s <= 0xff; s++) {
+		if (sdid >= 0 && s != sdid)
+			continue;
+		unsigned int idx = (did << 8) | s;
+		priv->subscribedPackets[idx >> 3] |= (1 << (idx & 7));
+	}
+	priv->filterPackets = 1;
+
+	return KLAPI_OK;
+}
+
+int klvanc_context_subscribe_lines(struct klvanc_context_s *ctx, unsigned int firstLine, unsigned int lastLine)
+{
+	VALIDATE(ctx);
+	if (firstLine > lastLine || lastLine >= KLVANC_SUBSCRIBE_MAX_LINES)
+		return -EINVAL;
+
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	for (unsigned int l = firstLine; l <= lastLine; l++)
+		priv->subscribedLines[l >> 3] |= (1 << (l & 7));
+	priv->filterLines = 1;
+
+	return KLAPI_OK;
+}
+
+void klvanc_context_subscribe_reset(struct klvanc_context_s *ctx)
+{
+	if (!ctx)
+		return;
+
+	struct vanc_context_private_s *priv = getPrivate(ctx);
+	memset(priv->subscribedPackets, 0, sizeof(priv->subscribedPackets));
+	memset(priv->subscribedLines, 0, sizeof(priv->subscribedLines));
+	priv->filterPackets = 0;
+	priv->filterLines = 0;
+}
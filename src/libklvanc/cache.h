@@ -35,12 +35,66 @@
 extern "C" {
 #endif  
 
+#define KLVANC_CACHE_MAX_LINES 2048
+#define KLVANC_CACHE_PAGE_LINES 64
+
+/**
+ * @brief	When packets arrive for a DID/SDID, or on one of its lines. Times are CLOCK_MONOTONIC
+ *		nanoseconds, frames are counted by klvanc_cache_frames(). The intervals are averaged
+ *		with a weight of 1/16 for the latest, 1e9 / intervalNs being the packet rate.
+ *		Read it with klvanc_cache_timing_read(). Describes the packets since the last reset,
+ *		while the entry or line is active.
+ */
+struct klvanc_cache_timing_s
+{
+	uint64_t        firstSeenNs;
+	uint64_t        lastSeenNs;
+	uint64_t        lastFrame;	/**< klvanc_cache_frames() minus this is frames since last seen */
+	uint64_t        intervalNs;	/**< Average time between packets, 0 until the second one */
+	uint64_t        jitterNs;	/**< Average distance of an interval from intervalNs */
+	uint64_t        minIntervalNs;
+	uint64_t        maxIntervalNs;
+
+	/* Library private, odd while being updated */
+	uint32_t        seq;
+};
+
+/**
+ * @brief	A packet as cached, see klvanc_cache_snapshot(). Its contents don't change
+ *		until it is released.
+ */
+struct klvanc_cache_snapshot_s
+{
+	struct klvanc_packet_header_s *pkt;	/**< The packet, raw and payload words included */
+	uint64_t        count;		/**< Packets seen on the line, this one included */
+	struct timeval  updated;	/**< When the packet was cached */
+
+	/* Library private */
+	int             refs;
+	struct klvanc_cache_snapshot_s *next;
+};
+
+struct klvanc_cache_history_ring_s;
+
 struct klvanc_cache_line_s
 {
 	int             active;
 	uint64_t        count;
+	unsigned int    lineNr;
+	struct klvanc_cache_timing_s timing;
+
+	/* The latest packet. The cache never blocks on the mutex, but won't reuse the
+	 * memory of a packet handed out here while the mutex is held.
+	 * klvanc_cache_snapshot() is the better way to read it.
+	 */
 	pthread_mutex_t mutex;
 	struct klvanc_packet_header_s *pkt;
+
+	/* Library private, the published snapshot and every buffer of the line */
+	struct klvanc_cache_snapshot_s *current;
+	struct klvanc_cache_snapshot_s *buffers;
+	struct klvanc_cache_line_s *next;
+	struct klvanc_cache_history_ring_s *history;
 };
 
 struct klvanc_cache_s
@@ -52,7 +106,47 @@ struct klvanc_cache_s
 	int            expandUI;
 	int            save;
 	uint32_t       activeCount;
-	struct klvanc_cache_line_s lines[2048];
+	struct klvanc_cache_timing_s timing;
+
+	/* Lines are allocated a page of KLVANC_CACHE_PAGE_LINES at a time, once a
+	 * line in the page has been seen. Use klvanc_cache_lookup_line() to reach them.
+	 */
+	struct klvanc_cache_line_s *pages[KLVANC_CACHE_MAX_LINES / KLVANC_CACHE_PAGE_LINES];
+
+	/* Library private, every entry and every line of this entry seen, newest first */
+	struct klvanc_cache_s *next;
+	struct klvanc_cache_line_s *seen;
+};
+
+enum klvanc_cache_change_e
+{
+	KLVANC_CACHE_INSERT = 1,	/**< First packet on the line since the cache was reset */
+	KLVANC_CACHE_UPDATE,		/**< A packet replaced the last one on the line */
+};
+
+/**
+ * @brief	An entry of the change journal, see klvanc_cache_changes()
+ */
+struct klvanc_cache_change_s
+{
+	uint64_t        seq;
+	enum klvanc_cache_change_e type;
+	uint8_t         did, sdid;
+	uint16_t        lineNr;
+};
+
+/* Changes the journal remembers before overwriting the oldest */
+#define KLVANC_CACHE_JOURNAL_SIZE 1024
+
+/**
+ * @brief	A packet from the history of a line, see klvanc_cache_history()
+ */
+struct klvanc_cache_history_s
+{
+	uint64_t        timeNs;		/**< When it was cached, as klvanc_cache_timing_s */
+	uint64_t        frame;		/**< klvanc_cache_frames() when it was cached */
+	unsigned int    rawLengthWords;
+	uint16_t       *raw;		/**< The packet's words, in the words array of the query */
 };
 
 /**
@@ -75,12 +169,171 @@ void klvanc_cache_reset(struct klvanc_context_s *ctx);
 
 /**
  * @brief	    When caching and summarizing VANC payload is enabled, lookup any statistics
- *              related to didnr and sdidnr.
+ *              related to didnr and sdidnr. The cache only holds the DID/SDID pairs seen in
+ *              the stream, pairs never seen share a single read only entry with an
+ *              activeCount of zero. Entries stay valid until the context is destroyed.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	uint8_t didnr - DID
+ * @param[in]	uint8_t sdidnr - SDID
+ * @return      The entry, or NULL when caching isn't enabled.
+ */
+struct klvanc_cache_s * klvanc_cache_lookup(struct klvanc_context_s *ctx, uint8_t didnr, uint8_t sdidnr);
+
+/**
+ * @brief	    Find line lineNr of a cache entry.
+ * @param[in]	struct klvanc_cache_s *e - Entry, from klvanc_cache_lookup().
+ * @param[in]	unsigned int lineNr - Line number, below KLVANC_CACHE_MAX_LINES.
+ * @return      The line, or NULL if the entry never had a packet on a line near lineNr.
+ *              Check active for whether the line has had a packet since the last reset.
+ */
+struct klvanc_cache_line_s * klvanc_cache_lookup_line(struct klvanc_cache_s *e, unsigned int lineNr);
+
+/**
+ * @brief	    Walk the DID/SDID pairs with packets cached since the last reset, without
+ *              probing every pair: start with klvanc_cache_first() and carry on with
+ *              klvanc_cache_next() until NULL. Entries seen later are added at the front.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @return      The first active entry, or NULL if there are none or caching isn't enabled.
+ */
+struct klvanc_cache_s * klvanc_cache_first(struct klvanc_context_s *ctx);
+
+/**
+ * @brief	    The active entry following e, see klvanc_cache_first().
+ * @param[in]	struct klvanc_cache_s *e - Entry
+ * @return      The next active entry, or NULL after the last.
+ */
+struct klvanc_cache_s * klvanc_cache_next(struct klvanc_cache_s *e);
+
+/**
+ * @brief	    As per klvanc_cache_first(), for the active lines of an entry.
+ * @param[in]	struct klvanc_cache_s *e - Entry
+ * @return      The first active line, or NULL if there are none.
+ */
+struct klvanc_cache_line_s * klvanc_cache_first_line(struct klvanc_cache_s *e);
+
+/**
+ * @brief	    The active line following line, see klvanc_cache_first_line().
+ * @param[in]	struct klvanc_cache_line_s *line - Line
+ * @return      The next active line of the same entry, or NULL after the last.
+ */
+struct klvanc_cache_line_s * klvanc_cache_next_line(struct klvanc_cache_line_s *line);
+
+/**
+ * @brief	    Sequence number of the latest change to the cache. Changes are numbered
+ *              from 1, and a monitor starting from the value returned here, after walking
+ *              the cache, can follow it with klvanc_cache_changes().
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @return      The sequence number, 0 before any change or when caching isn't enabled.
+ */
+uint64_t klvanc_cache_sequence(struct klvanc_context_s *ctx);
+
+/**
+ * @brief	    Read the journal of packets cached after sequence number since, oldest
+ *              first. The journal holds the last KLVANC_CACHE_JOURNAL_SIZE changes, a
+ *              monitor which falls further behind has to walk the cache again.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	uint64_t since - Last sequence number already seen.
+ * @param[out]	struct klvanc_cache_change_s *changes - Array receiving the changes.
+ * @param[in]	unsigned int max - Size of changes. Call again from the last seq returned
+ *              if it fills up.
+ * @return      Number of changes stored in changes, 0 if nothing changed.
+ * @return      -EOVERFLOW - Changes after since have already been overwritten.
+ * @return      < 0 - Error
+ */
+int klvanc_cache_changes(struct klvanc_context_s *ctx, uint64_t since,
+			 struct klvanc_cache_change_s *changes, unsigned int max);
+
+/**
+ * @brief	    Copy a timing struct consistently, without holding up the thread parsing VANC.
+ * @param[in]	const struct klvanc_cache_timing_s *timing - The timing of an entry or line.
+ * @param[out]	struct klvanc_cache_timing_s *copy - The copy.
+ */
+void klvanc_cache_timing_read(const struct klvanc_cache_timing_s *timing, struct klvanc_cache_timing_s *copy);
+
+/**
+ * @brief	    Frames seen by the cache. klvanc_frame_parse() and klvanc_frame_parse_format()
+ *              count each frame they parse, applications handing lines to klvanc_packet_parse()
+ *              call klvanc_cache_new_frame() at the start of every frame.
  * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @return      The number of frames, 0 when caching isn't enabled.
+ */
+uint64_t klvanc_cache_frames(struct klvanc_context_s *ctx);
+
+/**
+ * @brief	    Count the start of a frame, see klvanc_cache_frames().
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ */
+void klvanc_cache_new_frame(struct klvanc_context_s *ctx);
+
+/**
+ * @brief	    Keep a history of the packets cached on every DID/SDID and line, such as the
+ *              last few seconds of captions or SCTE-104, for looking back after an incident.
+ *              Each line gets a ring sized for depth packets like its first one, with room to
+ *              spare, allocated with the first packet. Once the rings add up to budget bytes,
+ *              lines seen later get no history. Requires klvanc_context_enable_cache().
+ *              Can't be changed once enabled.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	unsigned int depth - Packets to keep per line, from 1 to 65536.
+ * @param[in]	size_t budget - Bytes of history the context may hold, over every line.
  * @return      0 - Success
  * @return      < 0 - Error
  */
-struct klvanc_cache_s * klvanc_cache_lookup(struct klvanc_context_s *ctx, uint8_t didnr, uint8_t sdidnr);
+int klvanc_cache_enable_history(struct klvanc_context_s *ctx, unsigned int depth, size_t budget);
+
+/**
+ * @brief	    How much of the budget given to klvanc_cache_enable_history() is in use.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[out]	size_t *used - Bytes allocated to line histories.
+ * @param[out]	uint64_t *dropped - Packets not kept for lack of budget, or too large for their ring.
+ * @return      0 - Success
+ * @return      < 0 - Error
+ */
+int klvanc_cache_history_usage(struct klvanc_context_s *ctx, size_t *used, uint64_t *dropped);
+
+/**
+ * @brief	    Read back the packets of didnr/sdidnr on lineNr cached from fromNs to toNs
+ *              inclusive, oldest first, without holding up the thread parsing VANC. When
+ *              either array fills, the latest packets in range are returned; ask again with
+ *              toNs just before the first to page further back.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	uint8_t didnr - DID
+ * @param[in]	uint8_t sdidnr - SDID
+ * @param[in]	unsigned int lineNr - Line number
+ * @param[in]	uint64_t fromNs - Start of the range, CLOCK_MONOTONIC nanoseconds.
+ * @param[in]	uint64_t toNs - End of the range.
+ * @param[out]	struct klvanc_cache_history_s *records - Array receiving the packets.
+ * @param[in]	unsigned int maxRecords - Size of records.
+ * @param[out]	uint16_t *words - Array receiving the packets' words, records point into it.
+ * @param[in]	unsigned int maxWords - Size of words.
+ * @return      Number of packets stored in records.
+ * @return      < 0 - Error
+ */
+int klvanc_cache_history(struct klvanc_context_s *ctx, uint8_t didnr, uint8_t sdidnr, unsigned int lineNr,
+			 uint64_t fromNs, uint64_t toNs, struct klvanc_cache_history_s *records,
+			 unsigned int maxRecords, uint16_t *words, unsigned int maxWords);
+
+/**
+ * @brief	    Take a consistent view of the latest packet cached for didnr/sdidnr on
+ *              lineNr, without ever holding up the thread parsing VANC. The snapshot
+ *              stays valid, and unchanged, until klvanc_cache_snapshot_release(), or the
+ *              context is destroyed.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	uint8_t didnr - DID
+ * @param[in]	uint8_t sdidnr - SDID
+ * @param[in]	unsigned int lineNr - Line number
+ * @param[out]	struct klvanc_cache_snapshot_s **snap - The snapshot.
+ * @return      0 - Success
+ * @return      -ENOENT - No packet cached for didnr/sdidnr on lineNr since the last reset.
+ * @return      < 0 - Error
+ */
+int klvanc_cache_snapshot(struct klvanc_context_s *ctx, uint8_t didnr, uint8_t sdidnr,
+			  unsigned int lineNr, struct klvanc_cache_snapshot_s **snap);
+
+/**
+ * @brief	    Let go of a snapshot from klvanc_cache_snapshot().
+ * @param[in]	struct klvanc_cache_snapshot_s *snap - Snapshot, may be NULL.
+ */
+void klvanc_cache_snapshot_release(struct klvanc_cache_snapshot_s *snap);
 
 #ifdef __cplusplus
 };
@@ -35,6 +35,19 @@
 extern "C" {
 #endif
 
+/**
+ * @brief	Layouts klvanc_frame_parse_format() scans natively, all 4:2:2 with Cb first.
+ *		KLVANC_PIXFMT_UYVY8 carries b7-b0 of each ANC word, the ADF being 00/FF/FF. The
+ *		parity bits are regenerated, and the checksum is verified on its low 8 bits.
+ */
+enum klvanc_pixel_format_e
+{
+	KLVANC_PIXFMT_V210 = 0,	/**< 10 bit, 6 pixels in 4 little endian dwords */
+	KLVANC_PIXFMT_UYVY8,	/**< 8 bit Cb Y Cr Y */
+	KLVANC_PIXFMT_UYVY16,	/**< 16 bit little endian Cb Y Cr Y, samples in the low 10 bits */
+	KLVANC_PIXFMT_P210,	/**< 16 bit little endian Y plane then CbCr plane, samples in the high 10 bits */
+};
+
 /**
  * @brief	TODO - Brief description goes here.
  * @param[in]	const uint32_t * src - Brief description goes here.
@@ -73,7 +86,59 @@ void klvanc_v210_downscale_line_c(uint16_t * src, uint8_t * dst, int lines);
 void klvanc_v210_line_to_uyvy_c(const uint32_t * src, uint16_t * dst, int width);
 
 /**
- * @brief	Convert Y10 buffer to V210
+ * @brief	Extract only the luma samples of a v210 line. In HD, ANC is normally carried
+ *		in the Y data stream (ST 292), so this is half the output of
+ *		klvanc_v210_line_to_nv20_c() for the same packets.
+ * @param[in]	const uint32_t * src - v210 line.
+ * @param[out]	uint16_t * dst - width luma words.
+ * @param[in]	int width - Width of the line in pixels.
+ */
+void klvanc_v210_line_to_y10_c(const uint32_t * src, uint16_t * dst, int width);
+
+/**
+ * @brief	Same as klvanc_v210_line_to_y10_c(), using the fastest SIMD implementation
+ *		the CPU supports.
+ * @param[in]	const uint32_t * src - v210 line.
+ * @param[out]	uint16_t * dst - width luma words.
+ * @param[in]	int width - Width of the line in pixels.
+ */
+void klvanc_v210_line_to_y10(const uint32_t * src, uint16_t * dst, int width);
+
+/**
+ * @brief	Same as klvanc_v210_planar_unpack_c(), using the fastest SIMD implementation
+ *		the CPU supports (SSSE3, AVX2 or AVX-512), falling back to the C version.
+ * @param[in]	const uint32_t * src - v210 line.
+ * @param[out]	uint16_t * y - Luma plane, width words.
+ * @param[out]	uint16_t * u - Cb plane, width / 2 words.
+ * @param[out]	uint16_t * v - Cr plane, width / 2 words.
+ * @param[in]	int width - Width of the line in pixels, only whole groups of 6 are converted.
+ */
+void klvanc_v210_planar_unpack(const uint32_t * src, uint16_t * y, uint16_t * u, uint16_t * v, int width);
+
+/**
+ * @brief	Same as klvanc_v210_line_to_nv20_c(), using the fastest SIMD implementation
+ *		the CPU supports.
+ * @param[in]	const uint32_t * src - v210 line.
+ * @param[out]	uint16_t * dst - width luma words followed by width interleaved chroma words.
+ * @param[in]	int dstSizeBytes - Size of the dst buffer allocation.
+ * @param[in]	int width - Width of the line in pixels.
+ * @result 	0 - Success
+ * @result 	< 0 - Error
+ */
+int klvanc_v210_line_to_nv20(const uint32_t * src, uint16_t * dst, int dstSizeBytes, int width);
+
+/**
+ * @brief	Same as klvanc_v210_line_to_uyvy_c(), using the fastest SIMD implementation
+ *		the CPU supports.
+ * @param[in]	const uint32_t * src - v210 line.
+ * @param[out]	uint16_t * dst - width * 2 multiplexed words, rounded up to a group of 6 pixels.
+ * @param[in]	int width - Width of the line in pixels.
+ */
+void klvanc_v210_line_to_uyvy(const uint32_t * src, uint16_t * dst, int width);
+
+/**
+ * @brief	Convert Y10 buffer to V210, using the fastest SIMD implementation the CPU
+ *		supports (SSSE3 or AVX2), falling back to klvanc_y10_to_v210_c().
  * @param[in]	uint16_t * src - Array of 16-bit fields containing 10-bit Y values
  * @param[out]	uint8_t * dst - Destination containing resulting V210 video
  * @param[in]	int width - Number of Y pixels in src
@@ -81,13 +146,59 @@ void klvanc_v210_line_to_uyvy_c(const uint32_t * src, uint16_t * dst, int width)
 void klvanc_y10_to_v210(uint16_t *src, uint8_t *dst, int width);
 
 /**
- * @brief	Convert UYVY buffer to V210
+ * @brief	Convert Y10 buffer to V210, plain C version of klvanc_y10_to_v210().
+ * @param[in]	uint16_t * src - Array of 16-bit fields containing 10-bit Y values
+ * @param[out]	uint8_t * dst - Destination containing resulting V210 video
+ * @param[in]	int width - Number of Y pixels in src
+ */
+void klvanc_y10_to_v210_c(uint16_t *src, uint8_t *dst, int width);
+
+/**
+ * @brief	Convert UYVY buffer to V210, using the fastest SIMD implementation the CPU
+ *		supports (SSSE3 or AVX2), falling back to klvanc_uyvy_to_v210_c().
  * @param[in]	uint16_t * src - Array of 16-bit fields containing 10-bit YUV values
  * @param[out]	uint8_t * dst - Destination containing resulting V210 video
  * @param[in]	int width - Number of Y pixels in src
  */
 void klvanc_uyvy_to_v210(uint16_t *src, uint8_t *dst, int width);
 
+/**
+ * @brief	Convert UYVY buffer to V210, plain C version of klvanc_uyvy_to_v210().
+ * @param[in]	uint16_t * src - Array of 16-bit fields containing 10-bit YUV values
+ * @param[out]	uint8_t * dst - Destination containing resulting V210 video
+ * @param[in]	int width - Number of Y pixels in src
+ */
+void klvanc_uyvy_to_v210_c(uint16_t *src, uint8_t *dst, int width);
+
+/**
+ * @brief	Quickly test whether a v210 line could hold any ANC packets, without unpacking it.
+ *		Every packet starts with an ADF whose 3FF words can't occur in legal video, so a line
+ *		with no sample in the 3FC-3FF range holds no packets and needn't be scanned. Uses the
+ *		fastest SIMD implementation the CPU supports, one streaming read of the line.
+ * @param[in]	const uint32_t * src - v210 line.
+ * @param[in]	int width - Line width in pixels.
+ * @return	0 - The line holds no packets
+ * @return	1 - The line may hold packets
+ */
+int klvanc_v210_line_has_anc(const uint32_t *src, int width);
+
+/**
+ * @brief	Plain C version of klvanc_v210_line_has_anc().
+ * @param[in]	const uint32_t * src - v210 line.
+ * @param[in]	int width - Line width in pixels.
+ * @return	0 - The line holds no packets
+ * @return	1 - The line may hold packets
+ */
+int klvanc_v210_line_has_anc_c(const uint32_t *src, int width);
+
+/**
+ * @brief	Compare every SIMD pixel routine the CPU supports against the C versions,
+ *		for all widths up to UHD, reporting any mismatch to stderr.
+ * @return	0 - All implementations are bit exact
+ * @return	< 0 - Mismatch or allocation failure
+ */
+int klvanc_pixels_selftest(void);
+
 #ifdef __cplusplus
 };
 #endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2026 Kernel Labs Inc. All Rights Reserved
+ *
+ * Address: Kernel Labs Inc., PO Box 745, St James, NY. 11780
+ * Contact: sales@kernellabs.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file	stats.h
+ * @copyright	Copyright (c) 2026 Kernel Labs Inc. All Rights Reserved.
+ * @brief	Runtime statistics, packet counters and processing latency
+ */
+
+#ifndef _VANC_STATS_H
+#define _VANC_STATS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief	Log linear latency histogram. Each power of two range of nanoseconds is split into
+ *		four equal buckets, so any recorded value is known to within 25%.
+ *		Use klvanc_histogram_percentile() rather than walking the buckets by hand.
+ */
+#define KLVANC_HISTOGRAM_BUCKETS 160
+struct klvanc_histogram_s
+{
+	uint64_t count;
+	uint64_t totalNs;
+	uint64_t minNs;
+	uint64_t maxNs;
+	uint64_t buckets[KLVANC_HISTOGRAM_BUCKETS];
+};
+
+struct klvanc_stats_did_s
+{
+	uint8_t  did;
+	uint8_t  sdid;
+	uint64_t packets;
+	uint64_t decodeFailures;	/**< The decoder for this DID/SDID returned an error. */
+	uint64_t checksumFailures;
+};
+
+struct klvanc_stats_s
+{
+	uint64_t packets;		/**< Packets found, valid checksum or not. */
+	uint64_t packetsUnchanged;	/**< Packets delivered from the memo, see klvanc_context_enable_memo(). */
+	uint64_t decodeFailures;
+	uint64_t checksumFailures;
+	uint64_t linesScanned;
+	uint64_t linesBlank;		/**< Scanned lines the blank line pre-check ruled out. */
+	uint64_t bytesScanned;		/**< Input bytes scanned for packets, v210 or 16 bit words. */
+	uint64_t allocations;		/**< Calls into the system allocator on the parsing path. */
+	uint64_t framesGenerated;	/**< Calls to klvanc_generate_vanc_frame_v210(). */
+	uint64_t linesGenerated;	/**< Lines those calls wrote packets into. */
+	uint64_t linesReused;		/**< Of those, lines copied from the render cache. */
+
+	struct klvanc_histogram_s scan;		/**< Per line, locating and extracting packets. */
+	struct klvanc_histogram_s decode;	/**< Per packet, decoders, less any time in callbacks. */
+	struct klvanc_histogram_s callback;	/**< Per callback, time spent in the application. */
+	struct klvanc_histogram_s generate;	/**< Per frame, klvanc_generate_vanc_frame_v210(). */
+
+	uint64_t lines[KLVANC_SUBSCRIBE_MAX_LINES];	/**< Packets found per line number. */
+
+	unsigned int didCount;			/**< Entries in dids. */
+	struct klvanc_stats_did_s *dids;	/**< Every DID/SDID seen, in DID/SDID order. */
+};
+
+/**
+ * @brief	Start collecting statistics. Until called, the parsing path doesn't read the
+ *		clock or touch any counters. Once enabled, collection costs a few clock reads
+ *		per line and per packet, and is intended to be left on.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @return      0 - Success
+ * @return      < 0 - Error
+ */
+int klvanc_context_enable_stats(struct klvanc_context_s *ctx);
+
+/**
+ * @brief	Zero every counter and histogram. Call from the thread that parses.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ */
+void klvanc_context_stats_reset(struct klvanc_context_s *ctx);
+
+/**
+ * @brief	Snapshot the statistics collected since they were enabled, or last reset.
+ *		Counters are only ever written by the thread that parses and are read without
+ *		locking, so a snapshot taken from another thread may land mid packet.
+ *		Release the snapshot with klvanc_context_stats_free().
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[out]	struct klvanc_stats_s **stats - Newly allocated snapshot.
+ * @return      0 - Success
+ * @return      < 0 - Error
+ */
+int klvanc_context_get_stats(struct klvanc_context_s *ctx, struct klvanc_stats_s **stats);
+
+/**
+ * @brief	Free a snapshot returned by klvanc_context_get_stats().
+ * @param[in]	struct klvanc_stats_s *stats - Snapshot.
+ */
+void klvanc_context_stats_free(struct klvanc_stats_s *stats);
+
+/**
+ * @brief	Approximate latency at a given percentile.
+ * @param[in]	const struct klvanc_histogram_s *h - Histogram.
+ * @param[in]	double percentile - 0.0 to 100.0.
+ * @return      Upper bound in nanoseconds of the bucket holding the percentile, 0 if empty.
+ */
+uint64_t klvanc_histogram_percentile(const struct klvanc_histogram_s *h, double percentile);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* _VANC_STATS_H */
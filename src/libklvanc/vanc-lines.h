@@ -64,6 +64,8 @@ struct klvanc_line_s
 	int num_entries;
 };
 
+struct klvanc_line_arena_s;
+
 /**
  * @brief	Represents a group of VANC lines (e.g. perhaps corresponding to a video frame)
  */
@@ -72,8 +74,35 @@ struct klvanc_line_set_s
 {
 	int num_lines;
 	struct klvanc_line_s *lines[KLVANC_MAX_VANC_LINES];
+	struct klvanc_line_arena_s *arena;	/**< Set by klvanc_line_set_create(), NULL when the caller owns the set. */
 };
 
+/**
+ * @brief	Create a line set backed by an arena, intended to be created once per output
+ *              channel and reused for every frame. Lines, entries and payload copies all come
+ *              from the arena, so once it has grown to the largest frame seen, inserting does
+ *              no heap allocation. Lines are found by line number in constant time.\n
+ *              The lines of an arena backed set belong to it, don't pass them to
+ *              klvanc_line_free(), use klvanc_line_set_reset() between frames instead.
+ * @param[out]	struct klvanc_line_set_s **set - Newly created set.
+ * @return      0 - Success
+ * @return      -ENOMEM - insufficient memory
+ */
+int klvanc_line_set_create(struct klvanc_line_set_s **set);
+
+/**
+ * @brief	Empty a set created by klvanc_line_set_create(), ready for the next frame.
+ *              The arena keeps its memory.
+ * @param[in]	struct klvanc_line_set_s *set - Set to empty.
+ */
+void klvanc_line_set_reset(struct klvanc_line_set_s *set);
+
+/**
+ * @brief	Free a set created by klvanc_line_set_create(), with all of its lines.
+ * @param[in]	struct klvanc_line_set_s *set - Set to free.
+ */
+void klvanc_line_set_destroy(struct klvanc_line_set_s *set);
+
 /**
  * @brief	Create a VANC line
  *
@@ -161,6 +190,65 @@ int klvanc_generate_vanc_line(struct klvanc_context_s *ctx, struct klvanc_line_s
 int klvanc_generate_vanc_line_v210(struct klvanc_context_s *ctx, struct klvanc_line_s *line,
 				   uint8_t *out_buf, int line_pixel_width);
 
+/**
+ * @brief	Same placement of the line's VANC entries as klvanc_generate_vanc_line_v210(),
+ *              but written straight from the entries into the line's row of a v210 frame, with
+ *              no intermediate buffer and no allocation. Only the samples the packets occupy
+ *              are written: for HD that is the luma stream, chroma and the remainder of the
+ *              line keep whatever the frame already holds, so the caller decides how
+ *              blanking is filled.
+ *
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	struct klvanc_line_s *line - the VANC line to operate on
+ * @param[out]	uint8_t *frame - v210 frame, line->line_number is written to row
+ *              line->line_number - first_line.
+ * @param[in]	int stride - Bytes from the start of one row to the next.
+ * @param[in]	unsigned int first_line - SDI line number of the first row of the frame.
+ * @param[in]	unsigned int line_count - Number of rows in the frame.
+ * @param[in]	int line_pixel_width - Width of the frame in pixels, as per
+ *              klvanc_generate_vanc_line_v210().
+ * @return      0 - Success
+ * @return      -EINVAL - the line falls outside the frame, or the stride is too small
+ */
+int klvanc_generate_vanc_line_v210_frame(struct klvanc_context_s *ctx, struct klvanc_line_s *line,
+					 uint8_t *frame, int stride, unsigned int first_line,
+					 unsigned int line_count, int line_pixel_width);
+
+/**
+ * @brief	Keep the last rendering of each line number, with a fingerprint of the entries
+ *              it came from. klvanc_generate_vanc_line_v210(),
+ *              klvanc_generate_vanc_line_v210_frame() and klvanc_generate_vanc_frame_v210()
+ *              then only lay out and pack lines whose entries changed since the last frame,
+ *              stable lines such as AFD or HDR metadata are copied from the cache. Costs
+ *              one line of v210 per line number generated. Off by default.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @return      0 - Success
+ * @return      -ENOMEM - insufficient memory
+ */
+int klvanc_context_enable_render_cache(struct klvanc_context_s *ctx);
+
+/**
+ * @brief	Render every line of a set into the VANC area of a v210 frame in one call, each
+ *              as per klvanc_generate_vanc_line_v210_frame(). Lines of the set that fall outside
+ *              the frame are left out. With klvanc_context_enable_threads() the lines are
+ *              spread across the worker threads, which pays off for UHD rasters carrying
+ *              packets on many lines. When statistics are enabled each call is timed into the
+ *              generate histogram of struct klvanc_stats_s.
+ *
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	struct klvanc_line_set_s *set - Lines to render.
+ * @param[out]	uint8_t *frame - v210 frame, row 0 holding SDI line first_line.
+ * @param[in]	int stride - Bytes from the start of one row to the next.
+ * @param[in]	int width - Width of the frame in pixels.
+ * @param[in]	unsigned int first_line - SDI line number of the first row of the frame.
+ * @param[in]	unsigned int line_count - Number of rows in the frame.
+ * @return      Number of lines rendered.
+ * @return      -EINVAL - the stride is too small for the width
+ */
+int klvanc_generate_vanc_frame_v210(struct klvanc_context_s *ctx, struct klvanc_line_set_s *set,
+				    uint8_t *frame, int stride, int width,
+				    unsigned int first_line, unsigned int line_count);
+
 #ifdef __cplusplus
 };
 #endif  
@@ -53,7 +53,11 @@ enum klvanc_packet_type_e
 };
 
 /**
- * @brief	TODO - Brief description goes here.
+ * @brief	A single VANC packet, as detected by klvanc_packet_parse().\n
+ *		Headers handed to callbacks are views: payload and raw point directly into the
+ *		word buffer the caller passed to klvanc_packet_parse() and are only valid for the
+ *		duration of the callback. Use klvanc_packet_copy() to materialize a header that
+ *		owns its words, if the packet needs to be retained beyond the callback.
  */
 struct klvanc_packet_header_s
 {
@@ -63,13 +67,15 @@ struct klvanc_packet_header_s
 	unsigned short		dbnsdid;
 	unsigned short		checksum;
 #define LIBKLVANC_PACKET_MAX_PAYLOAD (16384)
-	unsigned short		payload[LIBKLVANC_PACKET_MAX_PAYLOAD];
+	unsigned short		*payload;		/**< User data words. Treat as read-only. */
 	unsigned short		payloadLengthWords;
 	unsigned int 		checksumValid;
+	unsigned int		parityValid;		/**< DID, SDID/DBN, DC and every UDW carry correct b8/b9 parity. */
 	unsigned int		lineNr; 		/**< The vanc in this header came from line.... */
-	unsigned short		raw[LIBKLVANC_PACKET_MAX_PAYLOAD];
+	unsigned short		*raw;			/**< Entire packet, ADF through checksum. Treat as read-only. */
 	unsigned int 		rawLengthWords;
 	unsigned short		horizontalOffset;	/**< Horizontal word where the ADF was detected. */
+	unsigned int		allocLengthWords;	/**< Capacity of payload and raw when materialized, 0 for a view. */
 };
 
 /**
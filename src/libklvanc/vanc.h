@@ -113,6 +113,15 @@ struct klvanc_callbacks_s
 	int (*sdp)(void *user_context, struct klvanc_context_s *, struct klvanc_packet_sdp_s *);
 	int (*smpte_12_2)(void *user_context, struct klvanc_context_s *, struct klvanc_packet_smpte_12_2_s *);
 	int (*smpte_2108_1)(void *user_context, struct klvanc_context_s *, struct klvanc_packet_smpte_2108_1_s *);
+	/* End of frame, every packet klvanc_frame_parse() found, in line and horizontal offset order.
+	 * The headers are only valid for the duration of the callback.
+	 */
+	int (*frame)(void *user_context, struct klvanc_context_s *, uint64_t frame_id,
+		     struct klvanc_packet_header_s *pkts, unsigned int count);
+	/* With klvanc_context_enable_memo(), a packet identical to the last one at its line and
+	 * horizontal offset. Fires in place of the all and decoded packet callbacks.
+	 */
+	int (*unchanged)(void *user_context, struct klvanc_context_s *, struct klvanc_packet_header_s *);
 };
 
 struct klvanc_cache_s;
@@ -136,16 +145,10 @@ struct klvanc_context_s
 	struct klrestricted_code_path_block_s rcp_failedToDecode;
 	unsigned int checksum_failures;
 
-	/* Optional: A cache of VANC lines we've detected in the stream.
-	 * see klvanc_context_enable_monitor().
-	 * A static array of structs, for did/sdid rapid lookups.
-	 * Where DD and SD range from 00..FF.
-	 * This contains an array of structs, each containing a set of lines,
-	 * optimized for update/query. The structures are typically used by
-	 * applications that want to keep tabs on what messages have been
-	 * seen in the stream, per line. Its important to understand that
-	 * for every message, we cache it, and the same message (same line)
-	 * overwrites our previous cached message.
+	/* No longer used, always NULL. The cache of VANC lines seen in the stream,
+	 * see klvanc_context_enable_cache(), is kept privately and only holds the
+	 * DID/SDID pairs and lines actually seen. Use klvanc_cache_lookup() and
+	 * klvanc_cache_lookup_line() to query it.
 	 */
 	struct klvanc_cache_s *cacheLines;
 
@@ -190,6 +193,37 @@ int klvanc_context_destroy(struct klvanc_context_s *ctx);
  */
 int klvanc_context_dump(struct klvanc_context_s *ctx);
 
+/**
+ * @brief	Only process packets with the given DID and SDID. Until the first subscription
+ *		every packet is processed, once subscribed all other packets are skipped by
+ *		klvanc_packet_parse() straight after their DID/SDID is read, without checksumming,
+ *		caching or any callbacks. May be called multiple times to subscribe to several packets.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	uint8_t did - Data ID.
+ * @param[in]	int sdid - Secondary Data ID, or -1 for every SDID (or DBN for type 1 packets) under did.
+ * @return      0 - Success
+ * @return      < 0 - Error
+ */
+int klvanc_context_subscribe(struct klvanc_context_s *ctx, uint8_t did, int sdid);
+
+/**
+ * @brief	Only scan lines firstLine through lastLine inclusive. Until the first call every
+ *		line is scanned, afterwards lines outside of all subscribed ranges are ignored
+ *		by klvanc_packet_parse() before any words are looked at.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	unsigned int firstLine, lastLine - Range of lines, below KLVANC_SUBSCRIBE_MAX_LINES.
+ * @return      0 - Success
+ * @return      < 0 - Error
+ */
+#define KLVANC_SUBSCRIBE_MAX_LINES 2048
+int klvanc_context_subscribe_lines(struct klvanc_context_s *ctx, unsigned int firstLine, unsigned int lastLine);
+
+/**
+ * @brief	Drop all packet and line subscriptions, processing everything again.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ */
+void klvanc_context_subscribe_reset(struct klvanc_context_s *ctx);
+
 /**
  * @brief	Parse a line of payload, trigger callbacks as necessary. lineNr is passed around and only\n
  *		used for reporting purposes, so we can figure out which line this came from in different\n
@@ -203,6 +237,78 @@ int klvanc_context_dump(struct klvanc_context_s *ctx);
  */
 int klvanc_packet_parse(struct klvanc_context_s *ctx, unsigned int lineNr, const unsigned short *words, unsigned int wordCount);
 
+/**
+ * @brief	Register an application decoder for a DID/SDID pair. Whenever a packet with this
+ *		DID/SDID is found (and its checksum is valid, see allow_bad_checksums) parse is called
+ *		to decode the header into a structure of the application's choosing, returned via its
+ *		void ** argument. cb is then called with the header and the decoded structure, after
+ *		which free releases it. Dispatch is a constant time table lookup.\n
+ *		Registering a DID/SDID the library already decodes replaces the builtin decoder.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	uint8_t did, uint8_t sdid - Packet identifiers to decode.
+ * @param[in]	parse - Decoder, returns 0 on success.
+ * @param[in]	free - Releases the decoded structure, may be NULL.
+ * @param[in]	cb - Called with ctx->callback_context and the decoded structure, may be NULL.
+ * @return      0 - Success
+ * @return      < 0 - Error
+ */
+int klvanc_register_decoder(struct klvanc_context_s *ctx, uint8_t did, uint8_t sdid,
+	int (*parse)(struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr, void **decoded),
+	void (*free)(void *decoded),
+	int (*cb)(void *user_context, struct klvanc_context_s *ctx, struct klvanc_packet_header_s *hdr, void *decoded));
+
+/**
+ * @brief	Parse the VANC area of a v210 frame, trigger callbacks as necessary.\n
+ *		Lines are first checked with klvanc_v210_line_has_anc(), pure blanking goes no further.
+ *		HD lines (width > 720) carry packets in separate luma and chroma streams. Luma is
+ *		unpacked and scanned, chroma is scanned directly in its packed form and only the words
+ *		of packets found are extracted. SD lines are unpacked as a single interleaved stream
+ *		and scanned as per klvanc_packet_parse(). Both use library owned scratch memory, reused
+ *		from frame to frame. Once every line is done the frame callback, if any, receives all
+ *		of the packets found in the frame. See klvanc_frame_parse_format() for other layouts.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	const uint8_t *v210 - First VANC line of the frame, in v210.
+ * @param[in]	int stride - Distance in bytes between the start of consecutive lines.
+ * @param[in]	int width - Line width in pixels.
+ * @param[in]	unsigned int first_line - SDI line number of the first line in v210.
+ * @param[in]	unsigned int line_count - Number of lines to parse.
+ * @param[in]	uint64_t frame_id - Caller's frame number, passed back through the frame callback.
+ * @return      The number of VANC packets found and parsing was attempted.
+ * @return      < 0 - Error
+ */
+int klvanc_frame_parse(struct klvanc_context_s *ctx, const uint8_t *v210, int stride, int width,
+		       unsigned int first_line, unsigned int line_count, uint64_t frame_id);
+
+#define KLVANC_MAX_THREADS 64
+
+/**
+ * @brief	Spread the scanning of lines in klvanc_frame_parse() across a pool of worker threads.\n
+ *		Workers locate, extract and checksum the packets of a line, the calling thread then
+ *		caches, decodes and triggers the callbacks for each line in turn, so callbacks still
+ *		arrive in line and horizontal offset order, on the thread that called
+ *		klvanc_frame_parse(), exactly as they would without workers. Off by default.
+ *		The same workers render lines for klvanc_generate_vanc_frame_v210().
+ *		Replaces any existing pool, zero threads stops the pool.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	int threads - Number of worker threads, 0 to KLVANC_MAX_THREADS.
+ * @return      0 - Success
+ * @return      < 0 - Error
+ */
+int klvanc_context_enable_threads(struct klvanc_context_s *ctx, int threads);
+
+/**
+ * @brief	Skip decoding packets that repeat frame after frame, such as AFD or HDR metadata.\n
+ *		Each line and horizontal offset remembers a 64 bit hash of the packet last seen there,
+ *		and the struct it decoded to. When the next packet there hashes the same, the unchanged
+ *		callback fires if set. Otherwise the all callback fires and the remembered struct is
+ *		delivered again, without decoding. Treat remembered structs as read-only. SCTE-104 is
+ *		always decoded. Off by default.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @return      0 - Success
+ * @return      < 0 - Error
+ */
+int klvanc_context_enable_memo(struct klvanc_context_s *ctx);
+
 /**
  * @brief	TODO - Brief description goes here.
  * @param[in]	uint16_t *array - Array of SDI words (10bit) that the caller wants parsed.
@@ -223,9 +329,30 @@ void klvanc_dump_words_console(struct klvanc_context_s *ctx, uint16_t *vanc, int
 #include <libklvanc/vanc-checksum.h>
 #include <libklvanc/smpte2038.h>
 #include <libklvanc/cache.h>
+#include <libklvanc/stats.h>
 #include <libklvanc/vanc-kl_u64le_counter.h>
 #include <libklvanc/vanc-sdp.h>
 
+/**
+ * @brief	As per klvanc_frame_parse(), for VANC delivered in any of the layouts of
+ *		enum klvanc_pixel_format_e. Lines are scanned in their native layout, without
+ *		conversion to v210, HD lines as separate luma and chroma streams.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	enum klvanc_pixel_format_e format - Layout of planes.
+ * @param[in]	const uint8_t *const planes[] - First VANC line of each plane, two for
+ *		KLVANC_PIXFMT_P210 and one otherwise.
+ * @param[in]	const int strides[] - Distance in bytes between the start of consecutive lines, per plane.
+ * @param[in]	int width - Line width in pixels.
+ * @param[in]	unsigned int first_line - SDI line number of the first line in planes.
+ * @param[in]	unsigned int line_count - Number of lines to parse.
+ * @param[in]	uint64_t frame_id - Caller's frame number, passed back through the frame callback.
+ * @return      The number of VANC packets found and parsing was attempted.
+ * @return      < 0 - Error
+ */
+int klvanc_frame_parse_format(struct klvanc_context_s *ctx, enum klvanc_pixel_format_e format,
+			      const uint8_t *const planes[], const int strides[], int width,
+			      unsigned int first_line, unsigned int line_count, uint64_t frame_id);
+
 /**
  * @brief	Take an array of payload, create a fully formed VANC message.
  *		bitDepth of 10 is the only valid input value.
@@ -260,7 +387,33 @@ const char *klvanc_lookupDescriptionByType(enum klvanc_packet_type_e type);
 const char *klvanc_lookupSpecificationByType(enum klvanc_packet_type_e type);
 
 /**
- * @brief	Create a copy of a packet header.
+ * @brief	Builtin decoders recycle their decoded packet structs through a per context free list
+ *		for each packet type, see klvanc_pool_stats().
+ */
+struct klvanc_pool_stats_s
+{
+	unsigned int inUse;		/**< Structs currently handed out, typically only during a callback. */
+	unsigned int available;		/**< Structs on the free list, ready for reuse. */
+	unsigned int highWater;		/**< Most structs ever in use at once. */
+	uint64_t allocations;		/**< Total calls into the system allocator. Stops rising once warm. */
+};
+
+/**
+ * @brief	Query the decoded packet pool for a packet type.
+ * @param[in]	struct klvanc_context_s *ctx - Context.
+ * @param[in]	enum klvanc_packet_type_e type - Packet type, as found in klvanc_packet_header_s.
+ * @param[out]	struct klvanc_pool_stats_s *stats - Current pool usage.
+ * @return      0 - Success
+ * @return      < 0 - Error
+ */
+int klvanc_pool_stats(struct klvanc_context_s *ctx, enum klvanc_packet_type_e type,
+		      struct klvanc_pool_stats_s *stats);
+
+/**
+ * @brief	Materialize a packet header. The copy owns storage for its payload and raw
+ *		words, sized to the packet rather than LIBKLVANC_PACKET_MAX_PAYLOAD, and stays
+ *		valid after the callback which delivered src has returned.
+ *		Release the copy with klvanc_packet_free().
  * @param[in]	struct packet_header_s **dst
  * @param[in]	struct packet_header_s *src
  * @return      0 - Success
@@ -299,6 +452,7 @@ void klvanc_packet_free(struct klvanc_packet_header_s *src);
 
 /**
  * @brief Append the payload words from srd to dst. Start copying from srcOffset position.
+ *        dst must be a materialized header with enough capacity, see allocLengthWords.
  * @return 0 on success, else < 0.
  */
 int klvanc_packet_payload_append(struct klvanc_packet_header_s *dst, struct klvanc_packet_header_s *src, int srcOffset);
@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2026 Kernel Labs Inc. All Rights Reserved
+ *
+ * Address: Kernel Labs Inc., PO Box 745, St James, NY. 11780
+ * Contact: sales@kernellabs.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Time the pixel conversion and line generation routines, C reference
+ * versions against whatever the library selected for this CPU.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <time.h>
+#include <libklvanc/vanc.h>
+#include <libklvanc/vanc-lines.h>
+
+#include "version.h"
+
+static int g_width = 1920;
+static int g_iterations = 100000;
+
+static double bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+static void bench_report(const char *name, double begin, double end)
+{
+	double ns = (end - begin) / g_iterations;
+	printf("%-28s %10.1f ns/call %12.0f calls/sec\n", name, ns, 1e9 / ns);
+}
+
+#define BENCH(name, call) \
+	do { \
+		double __begin = bench_now(); \
+		for (int __i = 0; __i < g_iterations; __i++) \
+			call; \
+		bench_report(name, __begin, bench_now()); \
+	} while (0)
+
+static int bench_pixels(void)
+{
+	int width = g_width;
+	size_t groups = (width + 5) / 6;
+	uint32_t *v210 = malloc(groups * 16);
+	size_t wordsSize = (groups * 18 + 64) * sizeof(uint16_t); /* nv20 wants width * 6 bytes */
+	uint16_t *words = malloc(wordsSize);
+	uint16_t *y = malloc((groups * 6 + 64) * sizeof(uint16_t));
+	uint16_t *u = malloc((groups * 3 + 64) * sizeof(uint16_t));
+	uint16_t *v = malloc((groups * 3 + 64) * sizeof(uint16_t));
+	if (!v210 || !words || !y || !u || !v) {
+		fprintf(stderr, "Unable to allocate buffers\n");
+		return -1;
+	}
+
+	for (size_t i = 0; i < groups * 4; i++)
+		v210[i] = rand() & 0x3fffffff;
+	for (size_t i = 0; i < groups * 12; i++)
+		words[i] = rand() & 0x3ff;
+
+	printf("v210 unpack, width %d\n", width);
+	BENCH("v210_planar_unpack_c", klvanc_v210_planar_unpack_c(v210, y, u, v, width));
+	BENCH("v210_planar_unpack", klvanc_v210_planar_unpack(v210, y, u, v, width));
+	BENCH("v210_line_to_nv20_c", klvanc_v210_line_to_nv20_c(v210, words, wordsSize, width));
+	BENCH("v210_line_to_nv20", klvanc_v210_line_to_nv20(v210, words, wordsSize, width));
+	BENCH("v210_line_to_uyvy_c", klvanc_v210_line_to_uyvy_c(v210, words, width));
+	BENCH("v210_line_to_uyvy", klvanc_v210_line_to_uyvy(v210, words, width));
+	BENCH("v210_line_to_y10_c", klvanc_v210_line_to_y10_c(v210, words, width));
+	BENCH("v210_line_to_y10", klvanc_v210_line_to_y10(v210, words, width));
+
+	for (size_t i = 0; i < groups * 12; i++)
+		words[i] = rand() & 0x3ff;
+
+	printf("\nv210 pack, width %d\n", width);
+	BENCH("y10_to_v210_c", klvanc_y10_to_v210_c(words, (uint8_t *)v210, width));
+	BENCH("y10_to_v210", klvanc_y10_to_v210(words, (uint8_t *)v210, width));
+	BENCH("uyvy_to_v210_c", klvanc_uyvy_to_v210_c(words, (uint8_t *)v210, width * 2));
+	BENCH("uyvy_to_v210", klvanc_uyvy_to_v210(words, (uint8_t *)v210, width * 2));
+
+	free(v210);
+	free(words);
+	free(y);
+	free(u);
+	free(v);
+
+	return 0;
+}
+
+/* A frame's worth of line set building, four packets over two lines */
+static void bench_set_heap(struct klvanc_context_s *ctx, uint16_t *words, uint16_t wordCount)
+{
+	struct klvanc_line_set_s set;
+
+	memset(&set, 0, sizeof(set));
+	for (int i = 0; i < 4; i++)
+		klvanc_line_insert(ctx, &set, words, wordCount, 9 + (i & 1), 0);
+	for (int i = 0; i < set.num_lines; i++)
+		klvanc_line_free(set.lines[i]);
+}
+
+static void bench_set_arena(struct klvanc_context_s *ctx, struct klvanc_line_set_s *set,
+			    uint16_t *words, uint16_t wordCount)
+{
+	for (int i = 0; i < 4; i++)
+		klvanc_line_insert(ctx, set, words, wordCount, 9 + (i & 1), 0);
+	klvanc_line_set_reset(set);
+}
+
+static int bench_line_set(void)
+{
+	struct klvanc_context_s *ctx;
+	struct klvanc_line_set_s *set;
+	uint8_t payload[255];
+	uint16_t *words;
+	uint16_t wordCount;
+
+	if (klvanc_context_create(&ctx) < 0) {
+		fprintf(stderr, "Error initializing library context\n");
+		return -1;
+	}
+	if (klvanc_line_set_create(&set) < 0) {
+		klvanc_context_destroy(ctx);
+		return -1;
+	}
+
+	for (unsigned int i = 0; i < sizeof(payload); i++)
+		payload[i] = rand();
+	if (klvanc_sdi_create_payload(0x07, 0x41, payload, sizeof(payload), &words, &wordCount, 10) < 0) {
+		klvanc_line_set_destroy(set);
+		klvanc_context_destroy(ctx);
+		return -1;
+	}
+
+	printf("\nVANC line set build and release, 4 packets\n");
+	BENCH("line_set_heap", bench_set_heap(ctx, words, wordCount));
+	BENCH("line_set_arena", bench_set_arena(ctx, set, words, wordCount));
+
+	free(words);
+	klvanc_line_set_destroy(set);
+	klvanc_context_destroy(ctx);
+
+	return 0;
+}
+
+/* A line carrying four maximum size packets, packed to v210 on every iteration */
+static int bench_generate(void)
+{
+	struct klvanc_context_s *ctx;
+	struct klvanc_line_set_s set;
+	uint8_t payload[255];
+	int ret = -1;
+
+	if (klvanc_context_create(&ctx) < 0) {
+		fprintf(stderr, "Error initializing library context\n");
+		return -1;
+	}
+
+	memset(&set, 0, sizeof(set));
+	for (unsigned int i = 0; i < sizeof(payload); i++)
+		payload[i] = rand();
+
+	for (int i = 0; i < 4; i++) {
+		uint16_t *words;
+		uint16_t wordCount;
+
+		if (klvanc_sdi_create_payload(0x07 + i, 0x41, payload, sizeof(payload), &words, &wordCount, 10) < 0)
+			goto bail;
+		if (klvanc_line_insert(ctx, &set, words, wordCount, 9, 0) < 0) {
+			free(words);
+			goto bail;
+		}
+		free(words);
+	}
+
+	uint8_t *v210 = malloc(((g_width + 5) / 6) * 16);
+	if (!v210)
+		goto bail;
+
+	printf("\nVANC line generation, width %d, 4 packets\n", g_width);
+	BENCH("generate_vanc_line_v210", klvanc_generate_vanc_line_v210(ctx, set.lines[0], v210, g_width));
+	BENCH("generate_vanc_line_v210_frame",
+	      klvanc_generate_vanc_line_v210_frame(ctx, set.lines[0], v210, ((g_width + 5) / 6) * 16, 9, 1, g_width));
+	free(v210);
+	ret = 0;
+
+bail:
+	for (int i = 0; i < set.num_lines; i++)
+		klvanc_line_free(set.lines[i]);
+	klvanc_context_destroy(ctx);
+
+	return ret;
+}
+
+/* Four packets on each of 12 lines, rendered into a frame per iteration */
+static int bench_generate_frame(void)
+{
+	struct klvanc_context_s *ctx;
+	struct klvanc_line_set_s *set;
+	unsigned int lines = 20;
+	int stride = ((g_width + 47) / 48) * 128;
+	uint8_t payload[255];
+	int ret = -1;
+
+	if (klvanc_context_create(&ctx) < 0) {
+		fprintf(stderr, "Error initializing library context\n");
+		return -1;
+	}
+	if (klvanc_line_set_create(&set) < 0) {
+		klvanc_context_destroy(ctx);
+		return -1;
+	}
+
+	uint8_t *frame = calloc(lines, stride);
+	if (!frame)
+		goto bail;
+
+	for (unsigned int i = 0; i < sizeof(payload); i++)
+		payload[i] = rand();
+	for (int l = 9; l <= 20; l++) {
+		for (int i = 0; i < 4; i++) {
+			uint16_t *words;
+			uint16_t wordCount;
+
+			if (klvanc_sdi_create_payload(0x07 + i, 0x41, payload, 60, &words, &wordCount, 10) < 0)
+				goto bail;
+			int r = klvanc_line_insert(ctx, set, words, wordCount, l, 0);
+			free(words);
+			if (r < 0)
+				goto bail;
+		}
+	}
+
+	printf("\nVANC frame generation, width %d, 12 lines of 4 packets\n", g_width);
+	BENCH("generate_vanc_frame_v210", klvanc_generate_vanc_frame_v210(ctx, set, frame, stride, g_width, 1, lines));
+	if (klvanc_context_enable_threads(ctx, 3) < 0)
+		goto bail;
+	BENCH("generate_vanc_frame_v210 x3", klvanc_generate_vanc_frame_v210(ctx, set, frame, stride, g_width, 1, lines));
+	if (klvanc_context_enable_threads(ctx, 0) < 0 || klvanc_context_enable_render_cache(ctx) < 0)
+		goto bail;
+	BENCH("generate_vanc_frame_v210 cached", klvanc_generate_vanc_frame_v210(ctx, set, frame, stride, g_width, 1, lines));
+	ret = 0;
+
+bail:
+	free(frame);
+	klvanc_line_set_destroy(set);
+	klvanc_context_destroy(ctx);
+
+	return ret;
+}
+
+/* A blanked VANC area carrying a single packet, parsed as one frame per iteration */
+static int bench_frame(void)
+{
+	struct klvanc_context_s *ctx;
+	unsigned int lines = 20;
+	int stride = ((g_width + 47) / 48) * 128;
+	uint8_t payload[8] = { 0x08 };
+	uint16_t *words;
+	uint16_t wordCount;
+	int ret = -1;
+
+	if (klvanc_context_create(&ctx) < 0) {
+		fprintf(stderr, "Error initializing library context\n");
+		return -1;
+	}
+
+	uint8_t *frame = malloc(stride * lines);
+	uint8_t *frame8 = malloc(g_width * 2 * lines);
+	uint16_t *line = malloc(g_width * 2 * sizeof(uint16_t));
+	if (!frame || !frame8 || !line)
+		goto bail;
+
+	/* Blanking, then an AFD packet at the start of the luma of the last line */
+	for (int i = 0; i < g_width * 2; i++)
+		line[i] = (i & 1) ? 0x040 : 0x200;
+	for (unsigned int l = 0; l < lines; l++)
+		klvanc_uyvy_to_v210(line, frame + l * stride, g_width * 2);
+	if (klvanc_sdi_create_payload(0x05, 0x41, payload, sizeof(payload), &words, &wordCount, 10) < 0)
+		goto bail;
+	for (int i = 0; i < wordCount; i++)
+		line[(i * 2) + 1] = words[i];
+	free(words);
+	klvanc_uyvy_to_v210(line, frame + (lines - 1) * stride, g_width * 2);
+
+	/* The same frame as 8 bit UYVY, ANC words carried as b7-b0 */
+	for (unsigned int l = 0; l < lines; l++) {
+		for (int i = 0; i < g_width * 2; i++)
+			frame8[(l * g_width * 2) + i] = (i & 1) ? 0x10 : 0x80;
+	}
+	for (int i = 0; i < g_width * 2; i += 2) {
+		if (line[i + 1] != 0x040)
+			frame8[((lines - 1) * g_width * 2) + i + 1] = line[i + 1] & 0xff;
+	}
+	const uint8_t *planes[] = { frame8 };
+	const int strides[] = { g_width * 2 };
+
+	printf("\nFrame parse, width %d, %u lines\n", g_width, lines);
+	BENCH("frame_parse", klvanc_frame_parse(ctx, frame, stride, g_width, 1, lines, __i));
+	BENCH("frame_parse_format uyvy8", klvanc_frame_parse_format(ctx, KLVANC_PIXFMT_UYVY8, planes, strides,
+								      g_width, 1, lines, __i));
+	ret = 0;
+
+bail:
+	free(frame);
+	free(frame8);
+	free(line);
+	klvanc_context_destroy(ctx);
+
+	return ret;
+}
+
+/* A handful of packet types on a few lines, the content a cache sees in a typical stream */
+static void bench_cache_fill(struct klvanc_context_s *ctx, uint16_t *words[], uint16_t wordCount[])
+{
+	for (int i = 0; i < 8; i++)
+		klvanc_packet_parse(ctx, 9 + (i & 3), words[i], wordCount[i]);
+}
+
+static int bench_cache(void)
+{
+	struct klvanc_context_s *ctx;
+	uint8_t payload[8] = { 0x08 };
+	uint16_t *words[8] = { NULL };
+	uint16_t wordCount[8];
+	int ret = -1;
+
+	if (klvanc_context_create(&ctx) < 0) {
+		fprintf(stderr, "Error initializing library context\n");
+		return -1;
+	}
+	if (klvanc_context_enable_cache(ctx) < 0)
+		goto bail;
+	for (int i = 0; i < 8; i++) {
+		if (klvanc_sdi_create_payload(i + 1, 0x50 + i, payload, sizeof(payload), &words[i], &wordCount[i], 10) < 0)
+			goto bail;
+	}
+
+	printf("\nVANC cache, 8 DID/SDID pairs on 4 lines\n");
+	BENCH("packet_parse cached x8", bench_cache_fill(ctx, words, wordCount));
+	BENCH("cache_reset", klvanc_cache_reset(ctx));
+	if (klvanc_cache_enable_history(ctx, 64, 1 << 20) < 0)
+		goto bail;
+	BENCH("packet_parse cached x8 history", bench_cache_fill(ctx, words, wordCount));
+	ret = 0;
+
+bail:
+	for (int i = 0; i < 8; i++)
+		free(words[i]);
+	klvanc_context_destroy(ctx);
+
+	return ret;
+}
+
+static int usage(const char *progname, int status)
+{
+	fprintf(stderr, COPYRIGHT "\n");
+	fprintf(stderr, "Benchmark the library pixel conversion and VANC line generation routines.\n");
+	fprintf(stderr, "Usage: %s [OPTIONS]\n", basename((char *)progname));
+
+	fprintf(stderr,
+		"    -w <width>      Line width in pixels (def: %d)\n"
+		"    -n <count>      Iterations per routine (def: %d)\n",
+		g_width, g_iterations);
+
+	exit(status);
+}
+
+int bench_main(int argc, char *argv[])
+{
+	int ch;
+
+	while ((ch = getopt(argc, argv, "?hw:n:")) != -1) {
+		switch (ch) {
+		case 'w':
+			g_width = atoi(optarg);
+			break;
+		case 'n':
+			g_iterations = atoi(optarg);
+			break;
+		case '?':
+		case 'h':
+		default:
+			usage(argv[0], 0);
+		}
+	}
+
+	if (g_width < 6 || g_iterations < 1)
+		usage(argv[0], 1);
+
+	if (bench_pixels() < 0)
+		return 1;
+	if (bench_line_set() < 0)
+		return 1;
+	if (bench_generate() < 0)
+		return 1;
+	if (bench_generate_frame() < 0)
+		return 1;
+	if (bench_frame() < 0)
+		return 1;
+	if (bench_cache() < 0)
+		return 1;
+
+	return 0;
+}
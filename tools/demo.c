@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <libklvanc/vanc.h>
+#include <libklvanc/vanc-lines.h>
 
 /* CALLBACKS for message notification */
 static int cb_AFD(void *callback_context, struct klvanc_context_s *ctx, struct klvanc_packet_afd_s *pkt)
@@ -372,6 +373,480 @@ static int test_checksum()
 	return 0;
 }
 
+static int test_pixels()
+{
+	if (klvanc_pixels_selftest() < 0)
+		return -1;
+
+	printf("Pixel conversion test passed.\n");
+
+	return 0;
+}
+
+static int memo_afd, memo_unchanged;
+
+static int cb_memo_AFD(void *callback_context, struct klvanc_context_s *ctx, struct klvanc_packet_afd_s *pkt)
+{
+	memo_afd++;
+	return 0;
+}
+
+static int cb_memo_unchanged(void *callback_context, struct klvanc_context_s *ctx, struct klvanc_packet_header_s *pkt)
+{
+	memo_unchanged++;
+	return 0;
+}
+
+static int test_memo()
+{
+	struct klvanc_callbacks_s cb = { .afd = cb_memo_AFD };
+	struct klvanc_context_s *ctx;
+	uint8_t afd[8] = { 0x20 };
+	uint16_t *words = NULL;
+	uint16_t wordCount;
+	int ret = -1;
+
+	if (klvanc_context_create(&ctx) < 0)
+		return -1;
+	ctx->callbacks = &cb;
+	if (klvanc_context_enable_memo(ctx) < 0)
+		goto bail;
+	if (klvanc_sdi_create_payload(0x05, 0x41, afd, sizeof(afd), &words, &wordCount, 10) < 0)
+		goto bail;
+
+	/* The repeat is delivered from the memo */
+	klvanc_packet_parse(ctx, 13, words, wordCount);
+	klvanc_packet_parse(ctx, 13, words, wordCount);
+	if (memo_afd != 2)
+		goto bail;
+
+	/* Or announced as unchanged, until the packet changes */
+	cb.unchanged = cb_memo_unchanged;
+	klvanc_packet_parse(ctx, 13, words, wordCount);
+	if (memo_afd != 2 || memo_unchanged != 1)
+		goto bail;
+	free(words);
+	afd[0] = 0x48;
+	if (klvanc_sdi_create_payload(0x05, 0x41, afd, sizeof(afd), &words, &wordCount, 10) < 0) {
+		words = NULL;
+		goto bail;
+	}
+	klvanc_packet_parse(ctx, 13, words, wordCount);
+	if (memo_afd != 3 || memo_unchanged != 1)
+		goto bail;
+
+	printf("Memoized decode test passed.\n");
+	ret = 0;
+
+bail:
+	free(words);
+	klvanc_context_destroy(ctx);
+	return ret;
+}
+
+/* An arena line set must generate the same lines as a heap one, frame after frame */
+static int test_line_set()
+{
+	static const int lineNrs[] = { 9, 10, 9, 12, 10, 9 };
+	struct klvanc_line_set_s heap, *arena = NULL;
+	struct klvanc_context_s *ctx;
+	uint8_t payload[32];
+	int ret = -1;
+
+	if (klvanc_context_create(&ctx) < 0)
+		return -1;
+	if (klvanc_line_set_create(&arena) < 0)
+		goto bail;
+
+	for (int frame = 0; frame < 3; frame++) {
+		memset(&heap, 0, sizeof(heap));
+		klvanc_line_set_reset(arena);
+
+		for (int i = 0; i < 6 - frame; i++) {
+			uint16_t *words;
+			uint16_t wordCount;
+
+			memset(payload, frame * 16 + i, sizeof(payload));
+			if (klvanc_sdi_create_payload(0x41, 0x07, payload, sizeof(payload) - i, &words, &wordCount, 10) < 0)
+				goto bail_frame;
+			int r = klvanc_line_insert(ctx, &heap, words, wordCount, lineNrs[i], 0) |
+				klvanc_line_insert(ctx, arena, words, wordCount, lineNrs[i], 0);
+			free(words);
+			if (r < 0)
+				goto bail_frame;
+		}
+
+		if (heap.num_lines != arena->num_lines)
+			goto bail_frame;
+		for (int i = 0; i < heap.num_lines; i++) {
+			uint16_t *a = NULL, *b = NULL;
+			int aLen, bLen;
+
+			if (heap.lines[i]->line_number != arena->lines[i]->line_number)
+				goto bail_frame;
+			klvanc_generate_vanc_line(ctx, heap.lines[i], &a, &aLen, 1920);
+			klvanc_generate_vanc_line(ctx, arena->lines[i], &b, &bLen, 1920);
+			int same = a && b && aLen == bLen && memcmp(a, b, aLen * sizeof(uint16_t)) == 0;
+			free(a);
+			free(b);
+			if (!same)
+				goto bail_frame;
+		}
+
+		for (int i = 0; i < heap.num_lines; i++)
+			klvanc_line_free(heap.lines[i]);
+		continue;
+
+bail_frame:
+		for (int i = 0; i < heap.num_lines; i++)
+			klvanc_line_free(heap.lines[i]);
+		goto bail;
+	}
+
+	printf("Line set test passed.\n");
+	ret = 0;
+
+bail:
+	klvanc_line_set_destroy(arena);
+	klvanc_context_destroy(ctx);
+	return ret;
+}
+
+/* Lines rendered into a frame must only change the samples their packets occupy */
+static int test_line_frame()
+{
+	static const int widths[] = { 1920, 720 };
+	struct klvanc_line_set_s *set = NULL;
+	struct klvanc_context_s *ctx;
+	uint8_t payload[40];
+	int ret = -1;
+
+	if (klvanc_context_create(&ctx) < 0)
+		return -1;
+	if (klvanc_line_set_create(&set) < 0)
+		goto bail;
+
+	for (int w = 0; w < 2; w++) {
+		int width = widths[w];
+		int stride = ((width + 47) / 48) * 128;
+		uint8_t *frame = malloc(stride * 3);
+		uint8_t *orig = malloc(stride * 3);
+		uint16_t *before = malloc(width * 2 * sizeof(uint16_t));
+		uint16_t *after = malloc(width * 2 * sizeof(uint16_t));
+		uint16_t *words = NULL;
+		int count = 0, ok = 0;
+
+		if (!frame || !orig || !before || !after)
+			goto bail_width;
+
+		/* Packets of odd lengths so they start and end part way through v210 groups */
+		klvanc_line_set_reset(set);
+		for (int i = 0; i < 3; i++) {
+			uint16_t *pkt;
+			uint16_t pktCount;
+
+			memset(payload, 0x10 + i, sizeof(payload));
+			if (klvanc_sdi_create_payload(0x41, 0x07, payload, 13 + (i * 7), &pkt, &pktCount, 10) < 0)
+				goto bail_width;
+			int r = klvanc_line_insert(ctx, set, pkt, pktCount, 10, 0);
+			free(pkt);
+			if (r < 0)
+				goto bail_width;
+		}
+
+		for (int i = 0; i < stride * 3; i++)
+			orig[i] = frame[i] = i * 7;
+		if (klvanc_generate_vanc_line(ctx, set->lines[0], &words, &count, width) < 0 || !words)
+			goto bail_width;
+		if (klvanc_generate_vanc_line_v210_frame(ctx, set->lines[0], frame, stride, 9, 3, width) < 0)
+			goto bail_width;
+
+		/* Rows either side are untouched, and so is everything on the row but the packets */
+		if (memcmp(frame, orig, stride) || memcmp(frame + stride * 2, orig + stride * 2, stride))
+			goto bail_width;
+		klvanc_v210_line_to_uyvy((uint32_t *)(orig + stride), before, width);
+		klvanc_v210_line_to_uyvy((uint32_t *)(frame + stride), after, width);
+		for (int i = 0; i < count; i++)
+			before[width > 720 ? (i * 2) + 1 : i] = words[i];
+		ok = memcmp(before, after, width * 2 * sizeof(uint16_t)) == 0;
+
+bail_width:
+		free(words);
+		free(frame);
+		free(orig);
+		free(before);
+		free(after);
+		if (!ok)
+			goto bail;
+	}
+
+	printf("Line frame generation test passed.\n");
+	ret = 0;
+
+bail:
+	klvanc_line_set_destroy(set);
+	klvanc_context_destroy(ctx);
+	return ret;
+}
+
+/* Whole frames, serial and threaded, must match rendering the lines one by one */
+static int test_frame_generate()
+{
+	struct klvanc_line_set_s *set = NULL;
+	struct klvanc_context_s *ctx;
+	struct klvanc_stats_s *stats;
+	int width = 1920, stride = 5120, rows = 20;
+	uint8_t *frames = calloc(3, stride * rows);
+	uint8_t payload[40];
+	int ret = -1;
+
+	if (!frames)
+		return -1;
+	if (klvanc_context_create(&ctx) < 0) {
+		free(frames);
+		return -1;
+	}
+	if (klvanc_context_enable_stats(ctx) < 0 || klvanc_line_set_create(&set) < 0)
+		goto bail;
+
+	/* Line 40 is beyond the frame and left out */
+	for (int l = 9; l <= 40; l += (l < 16 ? 1 : 24)) {
+		uint16_t *words;
+		uint16_t wordCount;
+
+		memset(payload, l, sizeof(payload));
+		if (klvanc_sdi_create_payload(0x41, 0x07, payload, 10 + (l & 15), &words, &wordCount, 10) < 0)
+			goto bail;
+		int r = klvanc_line_insert(ctx, set, words, wordCount, l, 0);
+		free(words);
+		if (r < 0)
+			goto bail;
+	}
+
+	for (int i = 0; i < set->num_lines; i++) {
+		if (set->lines[i]->line_number <= 20)
+			klvanc_generate_vanc_line_v210_frame(ctx, set->lines[i], frames, stride, 1, rows, width);
+	}
+	if (klvanc_generate_vanc_frame_v210(ctx, set, frames + stride * rows, stride, width, 1, rows) != 8)
+		goto bail;
+	if (klvanc_context_enable_threads(ctx, 2) < 0)
+		goto bail;
+	if (klvanc_generate_vanc_frame_v210(ctx, set, frames + stride * rows * 2, stride, width, 1, rows) != 8)
+		goto bail;
+	if (memcmp(frames, frames + stride * rows, stride * rows) ||
+	    memcmp(frames, frames + stride * rows * 2, stride * rows))
+		goto bail;
+
+	/* Rendered once into the cache, then copied from it */
+	if (klvanc_context_enable_render_cache(ctx) < 0)
+		goto bail;
+	for (int i = 0; i < 2; i++) {
+		memset(frames + stride * rows, 0, stride * rows);
+		klvanc_generate_vanc_frame_v210(ctx, set, frames + stride * rows, stride, width, 1, rows);
+		if (memcmp(frames, frames + stride * rows, stride * rows))
+			goto bail;
+	}
+
+	if (klvanc_context_get_stats(ctx, &stats) < 0)
+		goto bail;
+	int counted = stats->framesGenerated == 4 && stats->linesGenerated == 32 && stats->linesReused == 8 &&
+		      stats->generate.count == 4;
+	klvanc_context_stats_free(stats);
+	if (!counted)
+		goto bail;
+
+	printf("Frame generation test passed.\n");
+	ret = 0;
+
+bail:
+	klvanc_line_set_destroy(set);
+	klvanc_context_destroy(ctx);
+	free(frames);
+	return ret;
+}
+
+/* The cache holds just the DID/SDID pairs and lines seen, and forgets them on reset */
+static int test_cache()
+{
+	struct klvanc_context_s *ctx;
+	uint8_t payload[4] = { 0 };
+	int ret = -1;
+
+	if (klvanc_context_create(&ctx) < 0)
+		return -1;
+	if (klvanc_cache_lookup(ctx, 0x41, 0x07) || klvanc_context_enable_cache(ctx) < 0)
+		goto bail;
+
+	/* Enough pairs to grow the table a few times */
+	for (int i = 0; i < 40; i++) {
+		uint16_t *words;
+		uint16_t wordCount;
+
+		if (klvanc_sdi_create_payload(i + 1, 0x80 + i, payload, sizeof(payload), &words, &wordCount, 10) < 0)
+			goto bail;
+		klvanc_packet_parse(ctx, 9, words, wordCount);
+		klvanc_packet_parse(ctx, 9, words, wordCount);
+		klvanc_packet_parse(ctx, 600 + i, words, wordCount);
+		free(words);
+	}
+
+	for (int i = 0; i < 40; i++) {
+		struct klvanc_cache_s *e = klvanc_cache_lookup(ctx, 0x80 + i, i + 1);
+		struct klvanc_cache_line_s *line = klvanc_cache_lookup_line(e, 9);
+		if (!e || e->did != 0x80 + i || e->sdid != i + 1 || e->activeCount != 3)
+			goto bail;
+		if (!line || !line->active || line->count != 2 || !line->pkt || line->pkt->lineNr != 9)
+			goto bail;
+		line = klvanc_cache_lookup_line(e, 600 + i);
+		if (!line || line->count != 1 || klvanc_cache_lookup_line(e, 1000))
+			goto bail;
+	}
+
+	/* Walked without probing, and journalled packet by packet */
+	int entries = 0, lines = 0;
+	for (struct klvanc_cache_s *e = klvanc_cache_first(ctx); e; e = klvanc_cache_next(e)) {
+		entries++;
+		for (struct klvanc_cache_line_s *l = klvanc_cache_first_line(e); l; l = klvanc_cache_next_line(l))
+			lines += (l->lineNr == 9 || l->lineNr == 600 + e->did - 0x80);
+	}
+	struct klvanc_cache_change_s changes[128];
+	if (entries != 40 || lines != 80 || klvanc_cache_sequence(ctx) != 120 ||
+	    klvanc_cache_changes(ctx, 0, changes, 128) != 120 || klvanc_cache_changes(ctx, 120, changes, 128) != 0)
+		goto bail;
+	if (changes[0].seq != 1 || changes[0].type != KLVANC_CACHE_INSERT || changes[0].did != 0x80 ||
+	    changes[0].sdid != 1 || changes[0].lineNr != 9 || changes[1].type != KLVANC_CACHE_UPDATE ||
+	    changes[119].seq != 120 || changes[119].did != 0x80 + 39 || changes[119].lineNr != 639)
+		goto bail;
+
+	/* Timing of the pair, and of a line with two packets */
+	struct klvanc_cache_timing_s timing, lineTiming;
+	struct klvanc_cache_s *first = klvanc_cache_lookup(ctx, 0x80, 1);
+	klvanc_cache_timing_read(&first->timing, &timing);
+	klvanc_cache_timing_read(&klvanc_cache_lookup_line(first, 9)->timing, &lineTiming);
+	if (!timing.firstSeenNs || timing.lastSeenNs < timing.firstSeenNs || !timing.intervalNs ||
+	    timing.minIntervalNs > timing.maxIntervalNs || lineTiming.firstSeenNs != timing.firstSeenNs ||
+	    lineTiming.intervalNs != lineTiming.minIntervalNs || !first->lastUpdated.tv_sec ||
+	    klvanc_cache_frames(ctx) != 0)
+		goto bail;
+
+	struct klvanc_cache_s *unseen = klvanc_cache_lookup(ctx, 0x41, 0x07);
+	if (!unseen || unseen->activeCount || klvanc_cache_lookup_line(unseen, 9))
+		goto bail;
+
+	/* A snapshot keeps its packet while newer ones are cached */
+	struct klvanc_cache_snapshot_s *held, *snap;
+	if (klvanc_cache_snapshot(ctx, 0x80, 1, 9, &held) < 0 || held->count != 2 ||
+	    held->pkt->did != 0x80 || (held->pkt->payload[0] & 0xff) != 0)
+		goto bail;
+	for (int i = 1; i <= 3; i++) {
+		uint16_t *words;
+		uint16_t wordCount;
+
+		payload[0] = i;
+		klvanc_cache_new_frame(ctx);
+		if (klvanc_sdi_create_payload(1, 0x80, payload, sizeof(payload), &words, &wordCount, 10) < 0)
+			goto bail;
+		klvanc_packet_parse(ctx, 9, words, wordCount);
+		free(words);
+	}
+	if (klvanc_cache_snapshot(ctx, 0x80, 1, 9, &snap) < 0)
+		goto bail;
+	klvanc_cache_timing_read(&klvanc_cache_lookup_line(first, 9)->timing, &lineTiming);
+	int consistent = lineTiming.lastFrame == 3 && klvanc_cache_frames(ctx) == 3 && held->count == 2 && (held->pkt->payload[0] & 0xff) == 0 &&
+			 snap->count == 5 && (snap->pkt->payload[0] & 0xff) == 3 && snap->pkt->rawLengthWords == 11;
+	klvanc_cache_snapshot_release(snap);
+	klvanc_cache_snapshot_release(held);
+	if (!consistent || klvanc_cache_snapshot(ctx, 0x41, 0x07, 9, &snap) != -ENOENT)
+		goto bail;
+
+	klvanc_cache_reset(ctx);
+	if (klvanc_cache_snapshot(ctx, 0x80, 1, 9, &snap) != -ENOENT)
+		goto bail;
+	struct klvanc_cache_s *e = klvanc_cache_lookup(ctx, 0x80, 1);
+	struct klvanc_cache_line_s *line = klvanc_cache_lookup_line(e, 9);
+	if (e->activeCount || !line || line->active || line->count || line->pkt || klvanc_cache_first(ctx))
+		goto bail;
+
+	/* A monitor which falls a journal behind has to walk the cache again */
+	uint16_t *words;
+	uint16_t wordCount;
+	if (klvanc_sdi_create_payload(1, 0x80, payload, sizeof(payload), &words, &wordCount, 10) < 0)
+		goto bail;
+	for (int i = 0; i < KLVANC_CACHE_JOURNAL_SIZE; i++)
+		klvanc_packet_parse(ctx, 9, words, wordCount);
+	free(words);
+	if (klvanc_cache_changes(ctx, 122, changes, 128) != -EOVERFLOW ||
+	    klvanc_cache_changes(ctx, 123, changes, 128) != 128 ||
+	    changes[0].seq != 124 || changes[0].type != KLVANC_CACHE_INSERT)
+		goto bail;
+
+	printf("Cache test passed.\n");
+	ret = 0;
+
+bail:
+	klvanc_context_destroy(ctx);
+	return ret;
+}
+
+/* History keeps the last few packets of each line, within the context's budget */
+static int test_cache_history()
+{
+	struct klvanc_cache_history_s records[8];
+	struct klvanc_context_s *ctx;
+	uint8_t payload[4] = { 0 };
+	uint16_t words[128];
+	uint64_t dropped;
+	size_t used;
+	int ret = -1;
+
+	if (klvanc_context_create(&ctx) < 0)
+		return -1;
+	if (klvanc_context_enable_cache(ctx) < 0 || klvanc_cache_enable_history(ctx, 4, 1200) < 0)
+		goto bail;
+
+	/* Rings of 512 bytes, room for two lines */
+	for (int i = 0; i < 12; i++) {
+		uint16_t *pkt;
+		uint16_t wordCount;
+
+		payload[0] = i;
+		klvanc_cache_new_frame(ctx);
+		if (klvanc_sdi_create_payload(1, 0x80, payload, sizeof(payload), &pkt, &wordCount, 10) < 0)
+			goto bail;
+		klvanc_packet_parse(ctx, i < 10 ? 9 : i, pkt, wordCount);
+		free(pkt);
+	}
+	if (klvanc_cache_history_usage(ctx, &used, &dropped) < 0 || dropped != 1 ||
+	    used > 1200 || used < 1024)
+		goto bail;
+
+	int n = klvanc_cache_history(ctx, 0x80, 1, 9, 0, UINT64_MAX, records, 8, words, 128);
+	if (n != 4)
+		goto bail;
+	for (int i = 0; i < n; i++) {
+		if (records[i].rawLengthWords != 11 || (records[i].raw[6] & 0xff) != 6 + i ||
+		    records[i].frame != 7 + i || (i && records[i].timeNs < records[i - 1].timeNs))
+			goto bail;
+	}
+
+	/* Out of room, the latest in range are kept */
+	uint64_t from = records[1].timeNs;
+	if (klvanc_cache_history(ctx, 0x80, 1, 9, from, UINT64_MAX, records, 2, words, 128) != 2 ||
+	    (records[0].raw[6] & 0xff) != 8 || (records[1].raw[6] & 0xff) != 9 ||
+	    klvanc_cache_history(ctx, 0x80, 1, 9, 0, UINT64_MAX, records, 8, words, 20) != 1)
+		goto bail;
+	if (klvanc_cache_history(ctx, 0x80, 1, 10, 0, UINT64_MAX, records, 8, words, 128) != 1 ||
+	    klvanc_cache_history(ctx, 0x80, 1, 11, 0, UINT64_MAX, records, 8, words, 128) != 0)
+		goto bail;
+
+	printf("Cache history test passed.\n");
+	ret = 0;
+
+bail:
+	klvanc_context_destroy(ctx);
+	return ret;
+}
+
 static unsigned char __0_vancentry[] = {
 	0x00, 0x00, 0x03, 0xff, 0x03, 0xff, 0x02, 0x41, 0x01, 0x07, 0x01, 0x52,
 	0x01, 0x08, 0x02, 0xff, 0x02, 0xff, 0x02, 0x00, 0x01, 0x51, 0x02, 0x00,
@@ -515,6 +990,34 @@ int demo_main(int argc, char *argv[])
 	if (ret < 0)
 		fprintf(stderr, "Checksum calculation failed\n");
 
+	ret = test_pixels();
+	if (ret < 0)
+		fprintf(stderr, "Pixel conversion failed\n");
+
+	ret = test_memo();
+	if (ret < 0)
+		fprintf(stderr, "Memoized decode failed\n");
+
+	ret = test_line_set();
+	if (ret < 0)
+		fprintf(stderr, "Line set generation failed\n");
+
+	ret = test_line_frame();
+	if (ret < 0)
+		fprintf(stderr, "Line frame generation failed\n");
+
+	ret = test_frame_generate();
+	if (ret < 0)
+		fprintf(stderr, "Frame generation failed\n");
+
+	ret = test_cache();
+	if (ret < 0)
+		fprintf(stderr, "Cache failed\n");
+
+	ret = test_cache_history();
+	if (ret < 0)
+		fprintf(stderr, "Cache history failed\n");
+
 	ret = test_program_description_data(ctx);
 	if (ret < 0)
 		fprintf(stderr, "Program Description Data failed\n");
@@ -21,6 +21,8 @@ static struct klvanc_context_s *vanchdl;
 FILE *vancOutputFile = NULL;
 static int g_verbose = 0;
 static int g_saveVanc = 0;
+static int g_stats = 0;
+static int g_memo = 0;
 static unsigned int g_frameCount = 0;
 static unsigned int g_lastLine = 0;
 static unsigned int g_vancEntryCount = 0;
@@ -35,24 +37,10 @@ uint16_t g_filter_sdid = 0;
 static const char *g_vancOutputFilename = NULL;
 static const char *g_vancInputFilename = NULL;
 
-static void convert_colorspace_and_parse_vanc(unsigned char *buf, unsigned int uiWidth, unsigned int lineNr)
+static void convert_colorspace_and_parse_vanc(unsigned char *buf, unsigned int uiWidth, unsigned int uiStride, unsigned int lineNr)
 {
-	/* Convert the vanc line from V210 to CrCB422, then vanc parse it */
-
-	/* We need two kinds of type pointers into the source vbi buffer */
-	/* TODO: What the hell is this, two ptrs? */
-	const uint32_t *src = (const uint32_t *)buf;
-
-	/* Convert Blackmagic pixel format to nv20.
-	 * src pointer gets mangled during conversion, hence we need its own
-	 * ptr instead of passing vbiBufferPtr */
-	uint16_t decoded_words[16384];
-	memset(&decoded_words[0], 0, sizeof(decoded_words));
-	uint16_t *p_anc = decoded_words;
-	if (klvanc_v210_line_to_nv20_c(src, p_anc, sizeof(decoded_words), (uiWidth / 6) * 6) < 0)
-		return;
-
-	int ret = klvanc_packet_parse(vanchdl, lineNr, decoded_words, sizeof(decoded_words) / (sizeof(unsigned short)));
+	/* Have the library unpack the V210 line into its own scratch space and parse it */
+	int ret = klvanc_frame_parse(vanchdl, buf, uiStride, uiWidth, lineNr, 1, g_frameCount);
 	if (ret < 0) {
 		/* No VANC on this line */
 	}
@@ -154,7 +142,7 @@ static int AnalyzeVANC(const char *fn)
 			hexdump(buf, uiStride, 64);
 
 		g_filterMatch = 0;
-		convert_colorspace_and_parse_vanc(buf, uiStride, uiLine);
+		convert_colorspace_and_parse_vanc(buf, uiWidth, uiStride, uiLine);
 		if (g_filterMatch) {
 			g_filtermatchCount++;
 			/* Line matched filter criteria, so do something with it */
@@ -314,6 +302,40 @@ static struct klvanc_callbacks_s callbacks =
 
 /* END - CALLBACKS for message notification */
 
+static void print_histogram(const char *name, const struct klvanc_histogram_s *h)
+{
+	printf("%-8s count %" PRIu64 " avg %" PRIu64 "ns p50 %" PRIu64 "ns p99 %" PRIu64 "ns max %" PRIu64 "ns\n",
+		name, h->count, h->count ? h->totalNs / h->count : 0,
+		klvanc_histogram_percentile(h, 50.0), klvanc_histogram_percentile(h, 99.0), h->maxNs);
+}
+
+static void print_stats(struct klvanc_context_s *ctx)
+{
+	struct klvanc_stats_s *s;
+	if (klvanc_context_get_stats(ctx, &s) < 0)
+		return;
+
+	printf("packets %" PRIu64 " unchanged %" PRIu64 " checksum failures %" PRIu64 " decode failures %" PRIu64 "\n",
+		s->packets, s->packetsUnchanged, s->checksumFailures, s->decodeFailures);
+	printf("lines scanned %" PRIu64 " blank %" PRIu64 " bytes scanned %" PRIu64 " allocations %" PRIu64 "\n",
+		s->linesScanned, s->linesBlank, s->bytesScanned, s->allocations);
+	print_histogram("scan", &s->scan);
+	print_histogram("decode", &s->decode);
+	print_histogram("callback", &s->callback);
+	for (unsigned int i = 0; i < s->didCount; i++) {
+		const struct klvanc_stats_did_s *e = &s->dids[i];
+		printf("did 0x%02x sdid 0x%02x packets %" PRIu64 " checksum failures %" PRIu64 " decode failures %" PRIu64 " [%s]\n",
+			e->did, e->sdid, e->packets, e->checksumFailures, e->decodeFailures,
+			klvanc_didLookupDescription(e->did, e->sdid));
+	}
+	for (unsigned int i = 0; i < KLVANC_SUBSCRIBE_MAX_LINES; i++) {
+		if (s->lines[i])
+			printf("line %4u packets %" PRIu64 "\n", i, s->lines[i]);
+	}
+
+	klvanc_context_stats_free(s);
+}
+
 static int usage(const char *progname, int status)
 {
 	fprintf(stderr, COPYRIGHT "\n");
@@ -326,6 +348,8 @@ static int usage(const char *progname, int status)
 		"    -v              Increase level of verbosity (def: 0)\n"
 		"    -d <did>        Filter by DID\n"
 		"    -s <sdid>       Filter by SDID\n"
+		"    -S              Print packet and timing statistics on completion\n"
+		"    -M              Don't decode packets repeated at the same line and offset again\n"
 		"\n"
 		"Parse a file and output all SCTE-104 entries:\n"
 		"    %s -I foo.vanc -d 0x41 -s 0x07\n\n"
@@ -343,7 +367,7 @@ int parse_main(int argc, char *argv[])
 	int ch;
 	bool wantHelp = false;
 
-	while ((ch = getopt(argc, argv, "?hf:o:p:vxI:d:s:")) != -1) {
+	while ((ch = getopt(argc, argv, "?hf:o:p:vxI:d:s:SM")) != -1) {
 		switch (ch) {
 		case 'o':
 			g_vancOutputFilename = optarg;
@@ -363,6 +387,12 @@ int parse_main(int argc, char *argv[])
 		case 'x':
 			g_saveVanc++;
 			break;
+		case 'S':
+			g_stats = 1;
+			break;
+		case 'M':
+			g_memo = 1;
+			break;
 		case '?':
 		case 'h':
 			wantHelp = true;
@@ -381,6 +411,14 @@ int parse_main(int argc, char *argv[])
 
 	vanchdl->verbose = g_verbose;
 	vanchdl->callbacks = &callbacks;
+	if (g_stats)
+		klvanc_context_enable_stats(vanchdl);
+	if (g_memo)
+		klvanc_context_enable_memo(vanchdl);
+
+	/* Let the library discard anything we're not filtering for */
+	if (g_filter_did > 0)
+		klvanc_context_subscribe(vanchdl, g_filter_did, g_filter_sdid > 0 ? g_filter_sdid : -1);
 
 	if (g_vancOutputFilename != NULL) {
 		vancOutputFile = fopen(g_vancOutputFilename, "w");
@@ -392,7 +430,10 @@ int parse_main(int argc, char *argv[])
 	}
 
 	if (g_vancInputFilename != NULL) {
-		return AnalyzeVANC(g_vancInputFilename);
+		int ret = AnalyzeVANC(g_vancInputFilename);
+		if (g_stats)
+			print_stats(vanchdl);
+		return ret;
 	}
 
 	klvanc_context_destroy(vanchdl);